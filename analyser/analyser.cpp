@@ -3,27 +3,54 @@
 #include <climits>
 #include<iostream>
 #include<string>
-#include <stack>
 #include<cstring> 
 
 namespace miniplc0 {
-	int level = 0;
-	bool const_flag = false;
-	auto type_flag = TokenType::CHAR;
-	//gg
-	//stack<int> jmp_flag;
-	std::stack<int> jmp_flag;
-	std::string now;
-	std::pair<std::vector<Opr*>, std::optional<CompilationError>> Analyser::Analyse() {
+	std::pair<std::vector<Instruction>, std::optional<CompilationError>> Analyser::Analyse() {
 		auto err = analyseC0Program();
+		if (_lex_error.has_value())
+			return std::make_pair(std::vector<Instruction>(), _lex_error);
 		if (err.has_value())
-			return std::make_pair(std::vector<Opr*>(), err);
+			return std::make_pair(std::vector<Instruction>(), err);
+
+		// 语法树完整之后再统一生成代码。函数之间互不依赖，结果按函数下标存放，输出与串行时相同
+		Codegen gen;
+		gen.GenStart(_globals.head, _Sins);
+		_Ains.resize(_functions.size());
+		if (_pool != nullptr && _functions.size() > 1)
+			_pool->ParallelFor(_functions.size(), [this](std::size_t i) {
+				Codegen local;
+				local.GenFunction(_functions[i], _Ains[_functions[i].index]);
+			});
 		else
-			return std::make_pair(Sins, std::optional<CompilationError>());
+			for (auto& f : _functions)
+				gen.GenFunction(f, _Ains[f.index]);
+		computeStackDepths();
+		return std::make_pair(_Sins, std::optional<CompilationError>());
+	}
+
+	void Analyser::computeStackDepths() {
+		std::vector<CallTarget> callees(_funcList.size());
+		for (auto f : _funcList)
+			callees[f->index] = GetCallTarget(f->num_par, _Ains[f->index]);
+		auto one = [this, &callees](std::size_t i) {
+			auto f = _funcList[i];
+			StackAnalysis st;
+			// 语法分析拒绝了 void 函数的值，调用语句弹掉了返回值，生成的代码总能通过栈分析
+			if (st.Run(_Ains[f->index], f->num_par, f->level, callees).has_value())
+				DieAndPrint("generated code fails stack analysis.");
+			// 函数表里只有两个字节，放不下时记为未知
+			f->max_stack = st.MaxDepth() >= kUnknownDepth ? kUnknownDepth : st.MaxDepth();
+		};
+		if (_pool != nullptr && _funcList.size() > 1)
+			_pool->ParallelFor(_funcList.size(), one);
+		else
+			for (std::size_t i = 0; i < _funcList.size(); i++)
+				one(i);
 	}
 
 	std::optional<CompilationError> Analyser::analyseC0Program() {
-		auto err = analyseVarDec();
+		auto err = analyseVarDec(_globals);
 		if (err.has_value())
 			return err;
 		err = analyseFunDef();
@@ -33,7 +60,7 @@ namespace miniplc0 {
 		return {};
 	}
 	//Init时唯一出口是函数！；
-	std::optional<CompilationError> Analyser::analyseVarDec() {
+	std::optional<CompilationError> Analyser::analyseVarDec(ast::StmtList& out) {
 
 		while (true) {
 			auto next = nextToken();
@@ -47,13 +74,13 @@ namespace miniplc0 {
 				return {};
 			}
 			if (next.value().GetType() == TokenType::CONST)
-				const_flag = true;
+				_const_flag = true;
 			else
 				unreadToken();
 
 			next = nextToken();
 			if (next.value().GetType() == TokenType::VOID || next.value().GetType() == TokenType::INT) {
-				type_flag = next.value().GetType();
+				_type_flag = next.value().GetType();
 				next = nextToken();
 				next = nextToken();
 				if (next.value().GetType() == TokenType::ZKH) {
@@ -64,24 +91,24 @@ namespace miniplc0 {
 				}
 				unreadToken();
 				unreadToken();
-				auto errIDL = analyseInitDeclist();
+				auto errIDL = analyseInitDeclist(out);
 				if (errIDL.has_value())
 					return errIDL;
 			}
 
 			next = nextToken();
 			if (next.value().GetType() == TokenType::SEMICOLON) {
-				const_flag = false;
+				_const_flag = false;
 			}
 		}
 
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analyseInitDeclist() {
+	std::optional<CompilationError> Analyser::analyseInitDeclist(ast::StmtList& out) {
 
 		while (true) {
 			
-			auto err = analyseInitDec();
+			auto err = analyseInitDec(out);
 			if (err.has_value())
 				return err;
 			auto next = nextToken();
@@ -95,337 +122,179 @@ namespace miniplc0 {
 
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analyseInitDec(){
+	std::optional<CompilationError> Analyser::analyseInitDec(ast::StmtList& out){
 		auto next = nextToken();
 
 		if (next.value().GetType() != TokenType::IDENTIFIER) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrTypedef);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrTypedef);
 		}
 		auto me = next;
 		next = nextToken();
-		if (next.value().GetType() == TokenType::FZ) {
-			if (level == 0) {
-				miniplc0::Analyser::addGdt(me.value());
-				Var* sth = getG(me.value().GetValueString());
-				if (type_flag == TokenType::INT)
-					sth->type = 'i';
-				else
-					sth->type = 'v';
-				sth->_const = const_flag;
-				sth->_init = true;
-
-			}
-			else if(level==1){
-				addLdt(me.value());
-				Var* sth = getL(me.value().GetValueString());
-				if (type_flag == TokenType::INT)
-					sth->type = 'i';
-				else
-					sth->type = 'v';
-				sth->_const = const_flag;
-				sth->_init = true;
+		Var* sth = nullptr;
+		if (_level == 0) {
+			addGdt(me.value());
+			sth = getG(me.value().GetId());
+		}
+		else {
+			addLdt(me.value());
+			sth = getL(me.value().GetId());
+		}
+		sth->type = _type_flag == TokenType::INT ? 'i' : 'v';
+		sth->_const = _const_flag;
 
-			}
-			auto errExp = analyseExp();
+		// 变量的槽就是初值在栈上的位置
+		auto decl = newStmt(ast::STMT_DECL);
+		ast::Append(out, decl);
+		if (next.value().GetType() == TokenType::FZ) {
+			sth->_init = true;
+			auto errExp = analyseExp(decl->exp);
 			if (errExp.has_value())
 				return errExp;
-			return errExp;
+			// 常量的初值折叠成了字面量时记下它，之后的引用直接用值
+			if (sth->_const && decl->exp->kind == ast::EXPR_INT) {
+				sth->_known = true;
+				sth->_value = decl->exp->value;
+			}
 		}
 		else {
-			if (level == 0) {
-				addGdt(me.value());
-				Var* sth = getG(me.value().GetValueString());
-				if (type_flag == TokenType::INT)
-					sth->type = 'i';
-				else
-					sth->type = 'v';
-				sth->_const = const_flag;
-				sth->_init = false;
-
-				Opr* me = new Opr;
-				me->_opr = "ipush";
-				me->_x = "0";
-				me->_y.clear();
-				Sins.emplace_back(me);
-			}
-			else {
-				addLdt(me.value());
-				Var* sth = getL(me.value().GetValueString());
-				if (type_flag == TokenType::INT)
-					sth->type = 'i';
-				else
-					sth->type = 'v';
-				sth->_const = const_flag;
-				sth->_init = false;
-
-				Opr* me = new Opr;
-				me->_opr = "ipush";
-				me->_x = "0";
-				me->_y.clear();
-				Ains[now].emplace_back(me);
-			}
-			
+			sth->_init = false;
+			decl->exp = newInt(0);
 			unreadToken();
 		}
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analyseExp() {
+	std::optional<CompilationError> Analyser::analyseExp(ast::Expr*& out) {
 
-		auto errAExp = analyseAExp();
+		auto errAExp = analyseAExp(out);
 		if (errAExp.has_value()) {
 			return errAExp;
 		}
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analyseAExp() {
-		auto errMExp = analyseMExp();
+	std::optional<CompilationError> Analyser::analyseAExp(ast::Expr*& out) {
+		auto errMExp = analyseMExp(out);
 		if (errMExp.has_value())
 			return errMExp;
 
-		auto next = nextToken();
-		if (next.value().GetType() == TokenType::PLUS || next.value().GetType() == TokenType::MINUS) {
+		// 左结合：a - b + c 依次计算
+		while (true) {
+			auto next = nextToken();
+			if (!next.has_value())
+				return {};
+			if (next.value().GetType() != TokenType::PLUS && next.value().GetType() != TokenType::MINUS) {
+				unreadToken();
+				return {};
+			}
 
 			//只考虑了全为int
-			auto errMExp = analyseMExp();
-			
-			if (next.value().GetType() == TokenType::PLUS) {
-				if (level == 0) {
-
-					Opr* me = new Opr;
-					me->_opr = "iadd";
-					me->_x.clear();
-					me->_y.clear();
-					Sins.emplace_back(me);
-				}
-				else if (level == 1) {
+			ast::Expr* rhs = nullptr;
+			auto errMExp = analyseMExp(rhs);
+			if (errMExp.has_value())
+				return errMExp;
 
-					Opr* me = new Opr;
-					me->_opr = "iadd";
-					me->_x.clear();
-					me->_y.clear();
-					Ains[now].emplace_back(me);
-				}
-			}
-
-			else if (next.value().GetType() == TokenType::MINUS) {
-				if (level == 0) {
-					Opr* me = new Opr;
-					me->_opr = "isub";
-					me->_x.clear();
-					me->_y.clear();
-					Sins.emplace_back(me);
-				}
-				else if (level == 1) {
-					Opr* me = new Opr;
-					me->_opr = "isub";
-					me->_x.clear();
-					me->_y.clear();
-					Ains[now].emplace_back(me);
-				}
-			}
-			return errMExp;
+			out = newBinary(next.value().GetType() == TokenType::PLUS ? Operation::iadd : Operation::isub, out, rhs);
 		}
 
-		unreadToken();
-		return {};
-
 	}
-	std::optional<CompilationError> Analyser::analyseMExp() {
+	std::optional<CompilationError> Analyser::analyseMExp(ast::Expr*& out) {
 
-		auto errUExp = analyseUExp();
+		auto errUExp = analyseUExp(out);
 		if (errUExp.has_value())
 			return errUExp;
 
-		auto next = nextToken();
+		while (true) {
+			auto next = nextToken();
+			if (!next.has_value())
+				return {};
+			if (next.value().GetType() != TokenType::STAR && next.value().GetType() != TokenType::_DIV) {
+				unreadToken();
+				return {};
+			}
 
-		if (next.value().GetType() == TokenType::STAR || next.value().GetType() == TokenType::_DIV) {
+			ast::Expr* rhs = nullptr;
+			auto errUExp = analyseUExp(rhs);
+			if (errUExp.has_value())
+				return errUExp;
 
-			auto errUExp = analyseUExp();
-			
-			//操作show起来
-			if (next.value().GetType() == TokenType::STAR) {
-				if (level == 0) {
-					Opr* me = new Opr;
-					me->_opr = "imul";
-					me->_x.clear();
-					me->_y.clear();
-					Sins.emplace_back(me);
-				}
-				else if (level == 1) {
-					Opr* me = new Opr;
-					me->_opr = "imul";
-					me->_x.clear();
-					me->_y.clear();
-					Ains[now].emplace_back(me);
-				}
-			}
-			else if (next.value().GetType() == TokenType::_DIV) {
-				if (level == 0) {
-					Opr* me = new Opr;
-					me->_opr = "idiv";
-					me->_x.clear();
-					me->_y.clear();
-					Sins.emplace_back(me);
-				}
-				else if (level == 1) {
-					Opr* me = new Opr;
-					me->_opr = "idiv";
-					me->_x.clear();
-					me->_y.clear();
-					Ains[now].emplace_back(me);
-				}
-			}
-			return errUExp;
+			out = newBinary(next.value().GetType() == TokenType::STAR ? Operation::imul : Operation::idiv, out, rhs);
 		}
 
-		unreadToken();
-		return {};
-
 	}
-	std::optional<CompilationError> Analyser::analyseUExp() {
+	std::optional<CompilationError> Analyser::analyseUExp(ast::Expr*& out) {
 		auto next = nextToken();
 
 		if (next.value().GetType() != TokenType::PLUS && next.value().GetType() != TokenType::MINUS) {
 			unreadToken();
 		}
 		else if (next.value().GetType() == TokenType::MINUS) {
-			auto errP = analysePExp();
-			if (level == 0) {
-				Opr* me = new Opr;
-				me->_opr = "ineg";
-				me->_x.clear();
-				me->_y.clear();
-				Sins.emplace_back(me);
-			}
-			else {
-				Opr* me = new Opr;
-				me->_opr = "ineg";
-				me->_x.clear();
-				me->_y.clear();
-				Ains[now].emplace_back(me);
-			}
-			return errP;
+			auto errP = analysePExp(out);
+			if (errP.has_value())
+				return errP;
+			out = newNeg(out);
+			return {};
 		}
-		auto errP = analysePExp();
+		auto errP = analysePExp(out);
 
 		return errP;
 	}
-	std::optional<CompilationError> Analyser::analysePExp() {
+	std::optional<CompilationError> Analyser::analysePExp(ast::Expr*& out) {
 
 		auto next = nextToken();
 		if (next.value().GetType() == TokenType::ZKH) {
-			auto errE = analyseExp();
+			auto errE = analyseExp(out);
 			if (errE.has_value())
 				return errE;
 			next = nextToken();
 			if (next.value().GetType() != TokenType::YKH)
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 		else if (next.value().GetType() == TokenType::IDENTIFIER) {
-			if (isFunc(next.value().GetValueString())) {
+			if (isFunc(next.value().GetId())) {
+				// void 函数没有值可以参与运算
+				if (getFunc(next.value().GetId())->type == 'v')
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCalcVoid);
 				unreadToken();
-				auto errC = analyseFunCall();
+				return analyseFunCall(out);
 			}
 			else {
 				/*
-				if (!isDclr(next.value().GetValueString())) {
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNotDeclared);
+				if (!isDclr(next.value().GetId())) {
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotDeclared);
 				}
-				if (!isInit(next.value().GetValueString()))
+				if (!isInit(next.value().GetId()))
 				{
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNotInitialized);
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotInitialized);
 				}
-				if (isVoid(next.value().GetValueString())) {
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrCalcVoid);
+				if (isVoid(next.value().GetId())) {
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCalcVoid);
 				}*/
 
 
-				Var* _var = getL(next.value().GetValueString());
+				Var* _var = getL(next.value().GetId());
 				bool _L = true;
 				if (_var == nullptr) {
-					_var = getG(next.value().GetValueString());
+					_var = getG(next.value().GetId());
 					_L = false;
 				}
-				auto _index = _var->index;
-				if (_L) {
-					if (level == 0) {
-						Opr* me = new Opr;
-						me->_opr = "loada";
-						me->_x = "0";
-						me->_y = std::to_string(_index).c_str();
-						Sins.emplace_back(me);
-
-						me = new Opr;
-						me->_opr = "iload";
-						me->_x.clear();
-						me->_y.clear();
-						Sins.emplace_back(me);
-					}
-					else {
-						Opr* me = new Opr;
-						me->_opr = "loada";
-						me->_x = "0";
-						me->_y = std::to_string(_index).c_str();
-						Ains[now].emplace_back(me);
-
-						me = new Opr;
-						me->_opr = "iload";
-						me->_x.clear();
-						me->_y.clear();
-						Ains[now].emplace_back(me);
-					}
-				}
-				else {
-					if (level == 0) {
-
-						Opr* me = new Opr;
-						me->_opr = "loada";
-						me->_x = "0";
-						me->_y = std::to_string(_index).c_str();
-						Sins.emplace_back(me);
-						me = new Opr;
-						me->_opr = "iload";
-						me->_x.clear();
-						me->_y.clear();
-						Sins.emplace_back(me);
-					}
-					else {
-
-						Opr* me = new Opr;
-						me->_opr = "loada";
-						me->_x = "1";
-						me->_y = std::to_string(_index).c_str();
-						Ains[now].emplace_back(me);
-
-						me = new Opr;
-						me->_opr = "iload";
-						me->_x.clear();
-						me->_y.clear();
-						Ains[now].emplace_back(me);
-					}
+				if (_var == nullptr)
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotDeclared);
+				if (_var->_known) {
+					out = newInt(_var->_value);
+					return {};
 				}
-
+				out = newExpr(ast::EXPR_VAR);
+				out->value = _var->index;
+				// 全局变量在 .start 中是第 0 层，在函数中是第 1 层
+				out->level = _L ? 0 : _level;
 			}
 		}
 		else if (next.value().GetType() == TokenType::UNSIGNED_INTEGER) {
-			if (level == 0) {
-				Opr* me = new Opr;
-				me->_opr = "ipush";
-				me->_x = next.value().GetValueString();
-				me->_y.clear();
-				Sins.emplace_back(me);
-
-			}
-			else {
-				Opr* me = new Opr;
-				me->_opr = "ipush";
-				me->_x = next.value().GetValueString();
-				me->_y.clear();
-				Ains[now].emplace_back(me);
-			}
+			out = newInt(next.value().GetValue());
 		}
-		else
+		else {
+			out = newExpr(ast::EXPR_EMPTY);
 			unreadToken();
+		}
 		return {};
 	}
 
@@ -436,18 +305,17 @@ namespace miniplc0 {
 				return {};
 
 			if (next.value().GetType() != TokenType::INT && next.value().GetType() != TokenType::VOID)
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrTypedef);
-			type_flag = next.value().GetType();
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrTypedef);
+			_type_flag = next.value().GetType();
 			next = nextToken();
 			if (next.value().GetType() != TokenType::IDENTIFIER)
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrMustBeIdentifier);
-			if (!isFunc(next.value().GetValueString())) {
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrMustBeIdentifier);
+			if (!isFunc(next.value().GetId())) {
 				addConstantF(next.value());
 			}
 			else
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrRedefine);
-			now = next.value().GetValueString();
-			level = 1;
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrRedefine);
+			_level = 1;
 
 			clrLdt();
 
@@ -455,38 +323,36 @@ namespace miniplc0 {
 			if (errP.has_value())
 				return errP;
 			int32_t num_par = _nextLp;
-			auto type = type_flag;
 			addFunc(next.value());
-			Func* _f = getFunc(next.value().GetValueString());
+			Func* _f = getFunc(next.value().GetId());
+			_now = _f;
 			_f->num_par = num_par;
-			_f->name_index = getConst(next.value().GetValueString())->index;
-			_f->type = type_flag == TokenType::INT ? 'i' : 'v';
-			_f->level = level;
+			_f->name_index = getConst(next.value().GetId())->index;
+			_f->type = _type_flag == TokenType::INT ? 'i' : 'v';
+			_f->level = _level;
 
-			auto errComp = analyseComp();
-			level = 0;
+			ast::StmtList body{ nullptr, nullptr };
+			auto errComp = analyseComp(body);
+			_level = 0;
 			if (errComp.has_value())
 				return errComp;
+			_f->num_local = _nextLp;
 
-			Opr* me = new Opr;
-			me->_opr = "ret";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			_functions.push_back(ast::Function{ _f->index, _f->type == 'i', body.head });
 		}
 	}
 
 	std::optional<CompilationError> Analyser::analysePar() {
 		auto next = nextToken();
 		if (next.value().GetType() != TokenType::ZKH)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		auto errPDL = analysePDL();
 		if (errPDL.has_value())
 			return errPDL;
 		next = nextToken();
 
 		if (next.value().GetType() != TokenType::YKH)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		return {};
 	}
 	std::optional<CompilationError> Analyser::analysePDL() {
@@ -505,24 +371,24 @@ namespace miniplc0 {
 	std::optional<CompilationError> Analyser::analysePD() {
 		auto next = nextToken();
 
-		bool _const_flag = true;
+		bool par_const = true;
 		if (next.value().GetType() != TokenType::CONST) {
 			unreadToken();
-			_const_flag = false;
+			par_const = false;
 		}
 		next = nextToken();
-		auto _type_flag = TokenType::CHAR;
+		auto par_type = TokenType::CHAR;
 		if (next.value().GetType() == TokenType::VOID || next.value().GetType() == TokenType::INT) {
-			_type_flag = next.value().GetType();
+			par_type = next.value().GetType();
 			next = nextToken();
 			if (next.value().GetType() != TokenType::IDENTIFIER) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrMustBeIdentifier);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrMustBeIdentifier);
 			}
 			//进行符号表操作
 			addLdt(next.value());
-			Var* me = getL(next.value().GetValueString());
-			me->type = _type_flag == TokenType::VOID ? 'v' : 'i';
-			me->_const = _const_flag ? true : false;
+			Var* me = getL(next.value().GetId());
+			me->type = par_type == TokenType::VOID ? 'v' : 'i';
+			me->_const = par_const ? true : false;
 			me->_init = true;
 		}
 		else
@@ -530,46 +396,52 @@ namespace miniplc0 {
 		return {};
 	}
 
-	std::optional<CompilationError> Analyser::analyseFunCall() {
+	std::optional<CompilationError> Analyser::analyseFunCall(ast::Expr*& out) {
 		auto next = nextToken();
 
 		auto func = next;
-		if (!isFunc(func.value().GetValueString()))
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrMustBeIdentifier);
+		if (!isFunc(func.value().GetId()))
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrMustBeIdentifier);
 
 		next = nextToken();
 		if (next.value().GetType() != TokenType::ZKH)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 
-		auto errExpl = analyseExpl();
+		//操作 找到func在函数表中的位置 call
+		auto callee = getFunc(func.value().GetId());
+		out = newExpr(ast::EXPR_CALL);
+		out->value = callee->index;
+
+		auto errExpl = analyseExpl(out->lhs);
 		if (errExpl.has_value()) {
 			return errExpl;
 		}
 		next = nextToken();
 		if (next.value().GetType() != TokenType::YKH)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
-
-		//操作 找到func在函数表中的位置 call
-		int32_t _index = getFunc(func.value().GetValueString())->index;
-
-		
-		Opr* me = new Opr;
-		me->_opr = "call";
-		me->_x = std::to_string(_index);
-		me->_y.clear();
-		Ains[now].emplace_back(me);
-		
-		auto sz = Ains[now].size();
-
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
+
+		// f() 解析出唯一的一个空表达式，它不算参数；其余位置的空表达式是缺了实参
+		int32_t args = 0;
+		for (auto e = out->lhs; e != nullptr; e = e->next) {
+			if (e->kind != ast::EXPR_EMPTY)
+				args++;
+			else if (e != out->lhs || e->next != nullptr)
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrIncompleteExpression);
+		}
+		// 实参个数不对时生成的代码会让被调函数读到调用者的栈
+		if (args != callee->num_par)
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrArgCount);
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analyseExpl() {
+	std::optional<CompilationError> Analyser::analyseExpl(ast::Expr*& first) {
 		//根据IDENTIFIER求参数vector
+		auto link = &first;
 		while (true) {
-			auto errPD = analyseExp();
+			auto errPD = analyseExp(*link);
 			if (errPD.has_value())
 				return errPD;
 			//操作一下转类型之类的
+			link = &(*link)->next;
 
 			auto next = nextToken();
 			if (next.value().GetType() != TokenType::DOUHAO)
@@ -579,12 +451,12 @@ namespace miniplc0 {
 		return {};
 	}
 
-	std::optional<CompilationError> Analyser::analyseComp() {
-		level = 1;
+	std::optional<CompilationError> Analyser::analyseComp(ast::StmtList& out) {
+		_level = 1;
 		auto next = nextToken();
 		if (next.value().GetType() != TokenType::ZDKH)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
-		auto err = analyseVarDec();
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
+		auto err = analyseVarDec(out);
 		if (err.has_value())
 			return err;
 
@@ -593,21 +465,21 @@ namespace miniplc0 {
 
 		
 
-		auto errS = analyseStmtSeq();
+		auto errS = analyseStmtSeq(out);
 		if (errS.has_value()) {
 			return errS;
 		}
 
 		next = nextToken();
 		if (next.value().GetType() != TokenType::YDKH)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 
-		level = 0;
+		_level = 0;
 		return {};
 	}
 
 
-	std::optional<CompilationError> Analyser::analyseStmtSeq() {
+	std::optional<CompilationError> Analyser::analyseStmtSeq(ast::StmtList& out) {
 		while (true) {
 			auto next = nextToken();
 			unreadToken();
@@ -625,15 +497,14 @@ namespace miniplc0 {
 				return {};
 			}
 
-			auto errStmt = analyseStmt();
+			auto errStmt = analyseStmt(out);
 			if (errStmt.has_value())
 				return errStmt;
 
 		}
 	}
-	std::optional<CompilationError> Analyser::analyseStmt() {
+	std::optional<CompilationError> Analyser::analyseStmt(ast::StmtList& out) {
 		auto next = nextToken();
-		auto _opr = new Opr;
 		unreadToken();
 		std::optional<CompilationError> err = {};
 		if (!next.has_value())
@@ -655,112 +526,94 @@ namespace miniplc0 {
 		switch (next.value().GetType())
 		{
 		case TokenType::IF:
-			err = analyseCondStmt();
+			err = analyseCondStmt(out);
 			if (err.has_value())
 				return err;
 			break;
 		case TokenType::WHILE:
 		case TokenType::DO:
 		case TokenType::FOR:
-			err = analyseLoopStmt();
+			err = analyseLoopStmt(out);
 			if (err.has_value())
 				return err;
 			break;
 		case TokenType::RETURN:
-			err = analyseJumpStmt();
+			err = analyseJumpStmt(out);
 			if (err.has_value())
 				return err;
 			break;
 		case TokenType::PRINT:
-			err = analysePrintStmt();
+			err = analysePrintStmt(out);
 			if (err.has_value())
 				return err;
 			break;
 		case TokenType::SCAN:
-			err = analyseScanStmt();
+			err = analyseScanStmt(out);
 			if (err.has_value())
 				return err;
 			break;
 		case TokenType::IDENTIFIER:
 			next = nextToken();
-			if (isFunc(next.value().GetValueString())) {
+			if (isFunc(next.value().GetId())) {
 				unreadToken();
-				err = analyseFunCall();
+				auto call = newStmt(ast::STMT_CALL);
+				call->value = getFunc(next.value().GetId())->type == 'i';
+				ast::Append(out, call);
+				err = analyseFunCall(call->exp);
+				if (err.has_value())
+					return err;
 				break;
 			}
 			else {
 				auto me = next;
 				next = nextToken();
 				if (next.value().GetType() != TokenType::FZ)
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNotDeclared);
-
-				if (!isDclr(me.value().GetValueString()))
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNotDeclared);
-				/*if (!isInit(me.value().GetValueString()))
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNotInitialized);*/
-				if (isVoid(me.value().GetValueString()))
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrCalcVoid);
-				if (isConst(me.value().GetValueString()))
-					return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrCalcVoid);
-
-				Var* _var = getL(me.value().GetValueString());
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotDeclared);
+
+				if (!isDclr(me.value().GetId()))
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotDeclared);
+				/*if (!isInit(me.value().GetId()))
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotInitialized);*/
+				if (isVoid(me.value().GetId()))
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCalcVoid);
+				if (isConst(me.value().GetId()))
+					return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCalcVoid);
+
+				Var* _var = getL(me.value().GetId());
 				bool _L = true;
 				if (_var == nullptr) {
-					_var = getG(me.value().GetValueString());
+					_var = getG(me.value().GetId());
 					_L = false;
 				}
 
-				auto _index = _var->index;
-				if (_L) {
-					Opr* me = new Opr;
-					me->_opr = "loada";
-					me->_x = "0";
-					me->_y = std::to_string(_index).c_str();
-					Ains[now].emplace_back(me);
-					auto errExp = analyseExp();
-
-					me = new Opr;
-					me->_opr = "istore";
-					me->_x.clear();
-					me->_y.clear();
-					Ains[now].emplace_back(me);
-
-
-				}
-				else {
-					Opr* me = new Opr;
-					me->_opr = "loada";
-					me->_x = "1";
-					me->_y = std::to_string(_index);
-					Ains[now].emplace_back(me);
-					auto errExp = analyseExp();
-
-					me = new Opr;
-					me->_opr = "istore";
-					me->_x.clear();
-					me->_y.clear();
-					Ains[now].emplace_back(me);
-				}
+				auto assign = newStmt(ast::STMT_ASSIGN);
+				ast::Append(out, assign);
+				assign->level = _L ? 0 : 1;
+				assign->slot = _var->index;
+				err = analyseExp(assign->exp);
+				if (err.has_value())
+					return err;
 				next = nextToken();
 				unreadToken();
 				break;
 			}
-		case TokenType::ZDKH:
+		case TokenType::ZDKH: {
 			next = nextToken();
-			err = analyseStmtSeq();
+			auto block = newStmt(ast::STMT_BLOCK);
+			ast::Append(out, block);
+			ast::StmtList body{ nullptr, nullptr };
+			err = analyseStmtSeq(body);
 			if (err.has_value())
 				return err;
+			block->then = body.head;
 			next = nextToken();
 			if (next.value().GetType() != TokenType::YDKH)
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 			break;
+		}
 
 		case TokenType::SEMICOLON:
-			_opr = new Opr;
-			_opr->_opr = "nop";
-			_opr->_x.clear();
-			_opr->_y.clear();
-			Ains[now].emplace_back(_opr);
+			ast::Append(out, newStmt(ast::STMT_EMPTY));
 			next = nextToken();
 			break;
 		default:
@@ -770,9 +623,10 @@ namespace miniplc0 {
 		return {};
 	}
 
-	std::optional<CompilationError> Analyser::analyseCond() {
+	std::optional<CompilationError> Analyser::analyseCond(ast::Cond*& out) {
 		
-		auto errE = analyseExp();
+		out = _arena.New<ast::Cond>();
+		auto errE = analyseExp(out->lhs);
 
 		if (errE.has_value())
 			return errE;
@@ -782,13 +636,7 @@ namespace miniplc0 {
 		{
 
 			unreadToken();
-			jmp_flag.push(Ains[now].size());
-			auto me = new Opr;
-			me->_opr = "je";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
-			
+			out->jump = Operation::je;
 
 			return {};
 		}
@@ -799,62 +647,32 @@ namespace miniplc0 {
 			next.value().GetType() != TokenType::NE &&
 			next.value().GetType() != TokenType::EQ
 			)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrCompare);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCompare);
 
-		errE = analyseExp();
+		errE = analyseExp(out->rhs);
 		if (errE.has_value())
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
-
-		auto me = new Opr;
-		me->_opr = "icmp";
-		me->_x.clear();
-		me->_y.clear();
-		Ains[now].emplace_back(me);
-		jmp_flag.push(Ains[now].size());
-		me = new Opr;
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
+
+		out->compare = true;
 		switch (next.value().GetType())
 		{
 		case TokenType::LESS:
-			me = new Opr;
-			me->_opr = "jge";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			out->jump = Operation::jge;
 			break;
 		case TokenType::GREATER:
-			me = new Opr;
-			me->_opr = "jle";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			out->jump = Operation::jle;
 			break;
 		case TokenType::LOE:
-			me = new Opr;
-			me->_opr = "jg";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			out->jump = Operation::jg;
 			break;
 		case TokenType::GOE:
-			me = new Opr;
-			me->_opr = "jl";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			out->jump = Operation::jl;
 			break;
 		case TokenType::NE:
-			me = new Opr;
-			me->_opr = "je";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			out->jump = Operation::je;
 			break;
 		case TokenType::EQ:
-			me = new Opr;
-			me->_opr = "jne";
-			me->_x.clear();
-			me->_y.clear();
-			Ains[now].emplace_back(me);
+			out->jump = Operation::jne;
 			break;
 		default:
 			break;
@@ -863,189 +681,142 @@ namespace miniplc0 {
 		return{};
 	}
 
-	std::optional<CompilationError> Analyser::analyseCondStmt() {
+	std::optional<CompilationError> Analyser::analyseCondStmt(ast::StmtList& out) {
 		auto next = nextToken();
 		if (next.value().GetType() != TokenType::IF) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoIF);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoIF);
 		}
 		next = nextToken();
 		if (next.value().GetType() != TokenType::ZKH) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 
-		auto errC = analyseCond();
+		auto stmt = newStmt(ast::STMT_IF);
+		ast::Append(out, stmt);
+		auto errC = analyseCond(stmt->cond);
 		if (errC.has_value())
 			return errC;
 		next = nextToken();
 		if (next.value().GetType() != TokenType::YKH) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 
-		auto errS = analyseStmt();
+		ast::StmtList branch{ nullptr, nullptr };
+		auto errS = analyseStmt(branch);
 		if (errS.has_value()) {
 			return errS;
 		}
+		stmt->then = branch.head;
 
 
 
 		next = nextToken();
 		if (next.value().GetType() == TokenType::ELSE) {
-
-			auto nme = new Opr;
-			nme->_opr = "jmp";
-			nme->_x.clear();
-			nme->_y.clear();
-			Ains[now].emplace_back(nme);
-
-			auto chag = Ains[now];
-			auto me = chag.at(jmp_flag.top());
-			jmp_flag.pop();
-			me->_x = std::to_string(Ains[now].size()).c_str();
-
-			errS = analyseStmt();
+			stmt->value = true;
+			branch = ast::StmtList{ nullptr, nullptr };
+			errS = analyseStmt(branch);
 			if (errS.has_value())
 				return errS;
-
-			nme->_x = std::to_string(Ains[now].size()).c_str();
+			stmt->other = branch.head;
 		}
 		else {
-
-			auto chag = Ains[now];
-			auto me = chag.at(jmp_flag.top());
-			jmp_flag.pop();
-			me->_x = std::to_string(Ains[now].size()).c_str();
-
 			unreadToken();
 		}
 
 		return {};
 	}
 
-	std::optional<CompilationError> Analyser::analyseLoopStmt() {
+	std::optional<CompilationError> Analyser::analyseLoopStmt(ast::StmtList& out) {
 		
 		auto next = nextToken();
 		if (next.value().GetType() == TokenType::WHILE)  {
 			next = nextToken();
 			if (next.value().GetType() != TokenType::ZKH) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 			}
 
-			//循环之起始位置
-			auto xhqs = Ains[now].size();
-
-			auto errC = analyseCond();
+			auto stmt = newStmt(ast::STMT_WHILE);
+			ast::Append(out, stmt);
+			auto errC = analyseCond(stmt->cond);
 			if (errC.has_value())
 				return errC;
 			next = nextToken();
 			if (next.value().GetType() != TokenType::YKH) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 			}
 
-			auto errS = analyseStmt();
+			ast::StmtList body{ nullptr, nullptr };
+			auto errS = analyseStmt(body);
 			if (errS.has_value())
 				return errS;
-
-			auto me = new Opr;
-			me->_opr = "jmp";
-			me->_x = std::to_string(xhqs);
-			me->_y.clear();
-			Ains[now].emplace_back(me);
-
-
-			auto chag = Ains[now];
-			me = chag.at(jmp_flag.top());
-			jmp_flag.pop();
-			me->_x = std::to_string(Ains[now].size());
+			stmt->then = body.head;
 
 			return {};
 		}
 		else if (next.value().GetType() == TokenType::DO) {
-			auto xhqs = Ains[now].size();
+			auto stmt = newStmt(ast::STMT_DO);
+			ast::Append(out, stmt);
 
-			auto errS = analyseStmt();
+			ast::StmtList body{ nullptr, nullptr };
+			auto errS = analyseStmt(body);
 			if (errS.has_value())
 				return errS;
+			stmt->then = body.head;
 
 			next = nextToken();
 			if (next.value().GetType() != TokenType::WHILE) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoWHILE);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoWHILE);
 			}
 			next = nextToken();
 			if (next.value().GetType() != TokenType::ZKH) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 			}
-			auto errC = analyseCond();
+			auto errC = analyseCond(stmt->cond);
 			if (errC.has_value())
 				return errC;
 			if (next.value().GetType() != TokenType::YKH) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 			}
 			next = nextToken();
 			if (next.value().GetType() != TokenType::SEMICOLON) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 			}
 
-			auto me = new Opr;
-			me->_opr = "jmp";
-			me->_x = std::to_string(xhqs);
-			me->_y.clear();
-			Ains[now].emplace_back(me);
-
-			auto chag = Ains[now];
-			me = chag.at(jmp_flag.top());
-			jmp_flag.pop();
-			me->_x = std::to_string(Ains[now].size());
 			return {};
 		}
 		else if (next.value().GetType() == TokenType::FOR) {
 			next = nextToken();
 			if (next.value().GetType() != TokenType::ZKH) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
-			}
-			auto errF = analyseForinitStmt();
-			if (errF.has_value())
-				return errF;
-
-			auto errC = analyseCond();
-			if (errC.has_value())
-				return errC;
-
-			next = nextToken();
-			if (next.value().GetType() != TokenType::SEMICOLON) {
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 			}
-			auto errS = analyseStmt();
-			if (errS.has_value())
-				return errS;
-			auto chag = Ains[now];
-			auto me = chag.at(jmp_flag.top());
-			jmp_flag.pop();
-			me->_x = std::to_string(Ains[now].size());
-			return {};
+			// for 的初始化部分尚不支持，这里总是出错返回
+			return analyseForinitStmt();
 		}
 		else{
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 		}
 	}
 
 	std::optional<CompilationError> Analyser::analyseForinitStmt() {
 
-		return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+		return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 	}
 
-	std::optional<CompilationError> Analyser::analyseJumpStmt() {
+	std::optional<CompilationError> Analyser::analyseJumpStmt(ast::StmtList& out) {
 		
 		auto next = nextToken();
 		if (next.value().GetType() != TokenType::RETURN) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 		}
 		next = nextToken();
 		if (next.value().GetType() == TokenType::SEMICOLON) {
-			if(type_flag == TokenType::INT)
-				return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrIncompleteExpression);
+			if(_type_flag == TokenType::INT)
+				return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrIncompleteExpression);
 		}
 		unreadToken();
-		auto errPD = analyseExp();
+		auto stmt = newStmt(ast::STMT_RETURN);
+		ast::Append(out, stmt);
+		auto errPD = analyseExp(stmt->exp);
 		if (errPD.has_value()) {
 			return errPD;
 		}
@@ -1053,479 +824,319 @@ namespace miniplc0 {
 		next = nextToken();
 
 		if (next.value().GetType() != TokenType::SEMICOLON) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
-		}
-		Func* _f = getFunc(now);
-
-		if (_f->type == 'i') {
-			auto me = new Opr;
-			me->_opr = "iret";
-			me->_x.empty();
-			me->_y.empty();
-			Ains[now].emplace_back(me);
-		}
-		else {
-			auto me = new Opr;
-			me->_opr = "ret";
-			me->_x.empty();
-			me->_y.empty();
-			Ains[now].emplace_back(me);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 		}
+		stmt->value = _now->type == 'i';
 			
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analysePrint() {
+	std::optional<CompilationError> Analyser::analysePrint(ast::Expr*& first) {
 		
+		auto link = &first;
 		while (true) {
-			auto errE = analyseExp();
+			auto errE = analyseExp(*link);
 			if (errE.has_value())
 				return errE;
+			link = &(*link)->next;
 			auto next = nextToken();
-			auto me = new Opr;
-			me->_opr = "iprint";
-			me->_x.empty();
-			me->_y.empty();
-			Ains[now].emplace_back(me);
 			if (next.value().GetType() != TokenType::DOUHAO) {
 				unreadToken();
 				break;
 			}
-
-			me = new Opr;
-			me->_opr = "bipush";
-			me->_x = std::to_string(32);
-			me->_y.empty();
-			Ains[now].emplace_back(me);
-			me = new Opr;
-			me->_opr = "cprint";
-			me->_x.empty();
-			me->_y.empty();
-			Ains[now].emplace_back(me);
 		}
-		auto me = new Opr;
-		me->_opr = "printl";
-		me->_x.empty();
-		me->_y.empty();
-		Ains[now].emplace_back(me);
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analysePrintStmt() {
+	std::optional<CompilationError> Analyser::analysePrintStmt(ast::StmtList& out) {
 		auto next = nextToken();
 		if (next.value().GetType() != TokenType::PRINT) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 		next = nextToken();
 		if (next.value().GetType() != TokenType::ZKH) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 
-		auto errPD = analysePrint();
+		auto stmt = newStmt(ast::STMT_PRINT);
+		ast::Append(out, stmt);
+		auto errPD = analysePrint(stmt->exp);
 		if (errPD.has_value())
 			return errPD;
 
 		next = nextToken();
 		if (next.value().GetType() != TokenType::YKH) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 
 		next = nextToken();
 		if (next.value().GetType() != TokenType::SEMICOLON) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 		return {};
 	}
-	std::optional<CompilationError> Analyser::analyseScanStmt() {
+	std::optional<CompilationError> Analyser::analyseScanStmt(ast::StmtList& out) {
 		auto next = nextToken();
 		
 		if (next.value().GetType() != TokenType::SCAN) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoScan);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoScan);
 		}
 		next = nextToken();
 		if (next.value().GetType() != TokenType::ZKH) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 		next = nextToken();
 		if (next.value().GetType() != TokenType::IDENTIFIER)
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrMustBeIdentifier);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrMustBeIdentifier);
 		auto me = next;
 
-		if (!isDclr(me.value().GetValueString()))
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNotDeclared);
-		if (isVoid(me.value().GetValueString()))
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrCalcVoid);
-		if (isConst(me.value().GetValueString()))
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrCalcVoid);
+		if (!isDclr(me.value().GetId()))
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNotDeclared);
+		if (isVoid(me.value().GetId()))
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCalcVoid);
+		if (isConst(me.value().GetId()))
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrCalcVoid);
 
 		
 
-		Var* _var = getL(me.value().GetValueString());
+		Var* _var = getL(me.value().GetId());
 		bool _L = true;
 		if (_var == nullptr) {
-			_var = getG(me.value().GetValueString());
+			_var = getG(me.value().GetId());
 			_L = false;
 		}
-		auto _index = _var->index;
 		_var->_init = true;
-		if (_L) {
-
-			auto me = new Opr;
-			me->_opr = "loada";
-			me->_x = std::to_string(0).c_str();
-			me->_y = std::to_string(_index).c_str();
-			Ains[now].emplace_back(me);
-		}
-		else {
-			auto me = new Opr;
-			me->_opr = "loada";
-			me->_x = std::to_string(1).c_str();
-			me->_y = std::to_string(_index).c_str();
-			Ains[now].emplace_back(me);
-		}
 
 		next = nextToken();
 		if (next.value().GetType() != TokenType::YKH) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoKH);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoKH);
 		}
 		next = nextToken();
 		if (next.value().GetType() != TokenType::SEMICOLON) {
-			return std::make_optional<CompilationError>(_current_pos, ErrorCode::ErrNoSemicolon);
+			return std::make_optional<CompilationError>(currentPos(), ErrorCode::ErrNoSemicolon);
 		}
-		auto _opr = new Opr;
-		_opr->_opr = "iscan";
-		_opr->_x.clear();
-		_opr->_y.clear();
-		Ains[now].emplace_back(_opr);
-		_opr = new Opr;
-		_opr->_opr = "istore";
-		_opr->_x.clear();
-		_opr->_y.clear();
-		Ains[now].emplace_back(_opr);
+		auto stmt = newStmt(ast::STMT_SCAN);
+		ast::Append(out, stmt);
+		stmt->level = _L ? 0 : 1;
+		stmt->slot = _var->index;
 		
 		return {};
 	}
 
 	std::optional<Token> Analyser::nextToken() {
-		if (_offset == _tokens.size())
-			return {};
-		_current_pos = _tokens[_offset].GetEndPos();
-		return _tokens[_offset++];
+		if (_offset == _fetched) {
+			// 词法错误之后只返回 NULL_TOKEN，没有任何产生式接受它，分析会尽快出错返回
+			Token tk(TokenType::NULL_TOKEN, 0, _current_offset, _current_offset);
+			if (!_lex_error.has_value()) {
+				auto p = _tokenizer.NextToken();
+				if (p.second.has_value() && p.second.value().GetCode() == ErrorCode::ErrEOF)
+					return {};
+				if (p.second.has_value())
+					_lex_error = p.second;
+				else
+					tk = p.first.value();
+			}
+			_ring[_fetched++ % kLookahead] = tk;
+		}
+		auto& tk = _ring[_offset++ % kLookahead];
+		_current_offset = tk.GetEnd();
+		return tk;
 	}
 
-	//大端法转换四字节
-	void Analyser::binary4byte(int number, std::ostream& output) {
-		char buffer[4];
-		buffer[0] = ((number & 0xff000000) >> 24);
-		buffer[1] = ((number & 0x00ff0000) >> 16);
-		buffer[2] = ((number & 0x0000ff00) >> 8);
-		buffer[3] = ((number & 0x000000ff));
-		output.write(buffer, sizeof(buffer));
-	}
-	//大端法转换双字节
-	void Analyser::binary2byte(int number, std::ostream& output) {
-		char buffer[2];
-		buffer[0] = ((number & 0x0000ff00) >> 8);
-		buffer[1] = ((number & 0x000000ff));
-		output.write(buffer, sizeof(buffer));
-	}
 	//输出二进制文件
 	void Analyser::printBinary(std::ostream& output) {
+		// 先估计大小，避免拼装过程中反复扩容
+		std::size_t estimate = 16 + _Sins.size() * 5;
+		for (auto& ains : _Ains)
+			estimate += 12 + ains.size() * 5;
+		BinaryWriter out(estimate);
+
 		//首先书写固定字段magic和version
-		char magic[4];
-		magic[0] = 0x43;
-		magic[1] = 0x30;
-		magic[2] = 0x3a;
-		magic[3] = 0x29;
-		char version[4];
-		version[0] = 0;
-		version[1] = 0;
-		version[2] = 0;
-		version[3] = 1;
-		output.write(magic, sizeof(magic));
-		output.write(version, sizeof(version));
+		// 函数表带有栈深度时写 version 2；cc0-vm 两个版本都能读，version 1 的深度在加载时算出
+		out.PutU32(0x43303a29);
+		out.PutU32(2);
 
 		//输出const_count
-		int const_size = (int)_funcs.size();
-		binary2byte(const_size, output);
-
-		char buffer[1];
-		
-		int ct = _consts.size();
-		int ci = 0;
-		while (ci < ct) {
-			auto citer =_consts.begin();
-			while (citer != _consts.end()) {
-				if (citer->second->index == ci) {
-					char buffer[1];
-					buffer[0] = 0x00;
-					output.write(buffer, sizeof(char));
-					int len = citer->first.length();
-					binary2byte(len, output);
-					for (int j = 0; j < len; j++) {
-						buffer[0] = citer->first[j];
-						output.write(buffer, sizeof(char));
-					}
-				}
-				citer++;
-			}
-			ci++;
+		int const_size = (int)_funcs.Size();
+		out.PutU16(const_size);
+
+		for (auto c : _constList) {
+			out.PutU8(0x00);
+			auto name = _interner.Lookup(c->name);
+			out.PutU16(name.length());
+			out.PutBytes(name);
 		}
 
-		binary2byte(Sins.size(), output);
-		for (int i = 0; i < Sins.size(); i++) {
-			printBinaryInstruction(Sins.at(i), output);
-			
+		out.PutU16(_Sins.size());
+		for (auto& ins : _Sins)
+			out.PutInstruction(ins);
+		out.PutU16(_funcs.Size());
+
+		for (auto f : _funcList) {
+			out.PutU16(f->index);
+			out.PutU16(f->num_par);
+			out.PutU16(1);
+			// version 2：每个函数多出最大栈深度和局部槽数，虚拟机据此一次分配整个帧
+			out.PutU16(f->max_stack);
+			out.PutU16(f->num_local);
+			auto& ains = _Ains[f->index];
+			out.PutU16(ains.size());
+			for (auto& ins : ains)
+				out.PutInstruction(ins);
 		}
-		binary2byte(_funcs.size(), output);
-		
 
-		int ft = _funcs.size();
-		int fi = 0;
-		while (fi < ft) {
-			auto fiter = _funcs.begin();
-			while (fiter != _funcs.end()) {
-				if (fiter->second->index == fi) {
-					binary2byte(fi, output);
-					binary2byte(fiter->second->num_par, output);
-					binary2byte(1, output);
-					binary2byte(Ains[fiter->first].size(), output);
-					for (int j = 0, tt = Ains[fiter->first].size(); j < tt; j++) {
-						printBinaryInstruction(Ains[fiter->first].at(j), output);
-					}
-				}
-				fiter++;
-			}
-			fi++;
-		}
+		out.WriteTo(output);
 	}
 
-	void Analyser::printBinaryInstruction(Opr* opr, std::ostream& output) {
-		
-		char buffer[1];
-			if (strcmp(opr->_opr, "nop") == 0) {
-				buffer[0] = 0x00;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "bipush") == 0) {
-				buffer[0] = 0x01;
-				output.write(buffer, sizeof(char));
-				buffer[0] = atoi(opr->_x.c_str()) & 0xff;
-				output.write(buffer, sizeof(char));
-			}
-			else if(strcmp(opr->_opr,"ipush") == 0)
-			{
-				buffer[0] = 0x02;
-				output.write(buffer, sizeof(char));
-				binary4byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "pop") == 0) {
-				buffer[0] = 0x04;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "loadc") == 0) {
-				buffer[0] = 0x09;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "loada") == 0) {
-				buffer[0] = 0x0a;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
+	ast::Expr* Analyser::newExpr(ast::ExprKind kind) {
+		auto exp = _arena.New<ast::Expr>();
+		exp->kind = kind;
+		return exp;
+	}
 
-				binary4byte(atoi(opr->_y.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "iload") == 0) {
-				buffer[0] = 0x10;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "istore") == 0) {
-				buffer[0] = 0x20;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "iadd") == 0) {
-				buffer[0] = 0x30;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "isub") == 0) {
-				buffer[0] = 0x34;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "imul") == 0) {
-				buffer[0] = 0x38;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "idiv") == 0) {
-				buffer[0] = 0x3c;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "ineg") == 0) {
-				buffer[0] = 0x40;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "icmp") == 0) {
-				buffer[0] = 0x44;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "jmp") == 0) {
-				buffer[0] = 0x70;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "je") == 0) {
-				buffer[0] = 0x71;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "jne") == 0) {
-				buffer[0] = 0x72;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "jl") == 0) {
-				buffer[0] = 0x73;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "jge") == 0) {
-				buffer[0] = 0x74;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "jg") == 0) {
-				buffer[0] = 0x75;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "jle") == 0) {
-				buffer[0] = 0x76;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "call") == 0) {
-				buffer[0] = 0x80;
-				output.write(buffer, sizeof(char));
-				binary2byte(atoi(opr->_x.c_str()), output);
-			}
-			else if (strcmp(opr->_opr, "ret") == 0) {
-				buffer[0] = 0x88;
-				output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "iret") == 0) {
-			buffer[0] = 0x89;
-			output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "iprint") == 0) {
-			buffer[0] = 0xa0;
-			output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "cprint") == 0) {
-			buffer[0] = 0xa2;
-			output.write(buffer, sizeof(char));
-			}
-			else if (strcmp(opr->_opr, "printl") == 0) {
-			buffer[0] = 0xaf;
-			output.write(buffer, sizeof(char));
+	ast::Expr* Analyser::newInt(int32_t value) {
+		auto exp = newExpr(ast::EXPR_INT);
+		exp->value = value;
+		return exp;
+	}
+
+	ast::Expr* Analyser::newBinary(Operation opr, ast::Expr* lhs, ast::Expr* rhs) {
+		// 两个操作数都是字面量时直接算出结果
+		if (lhs->kind == ast::EXPR_INT && rhs->kind == ast::EXPR_INT) {
+			int64_t a = lhs->value, b = rhs->value, r;
+			bool ok = true;
+			switch (opr) {
+			case Operation::iadd: r = a + b; break;
+			case Operation::isub: r = a - b; break;
+			case Operation::imul: r = a * b; break;
+			case Operation::idiv:
+				ok = b != 0;
+				r = ok ? a / b : 0;
+				break;
+			default: ok = false; r = 0; break;
 			}
-			else if (strcmp(opr->_opr, "iscan") == 0) {
-			buffer[0] = 0xb0;
-			output.write(buffer, sizeof(char));
+			// 会溢出或者除零的表达式照常发出，保留虚拟机的运行时错误
+			if (ok && r >= INT_MIN && r <= INT_MAX) {
+				lhs->value = (int32_t)r;
+				return lhs;
 			}
 		}
+		auto exp = newExpr(ast::EXPR_BINARY);
+		exp->op = opr;
+		exp->lhs = lhs;
+		exp->rhs = rhs;
+		return exp;
+	}
+
+	ast::Expr* Analyser::newNeg(ast::Expr* operand) {
+		// 对字面量取负直接折叠，INT_MIN 留给运行时报溢出
+		if (operand->kind == ast::EXPR_INT && operand->value != INT_MIN) {
+			operand->value = -operand->value;
+			return operand;
+		}
+		auto exp = newExpr(ast::EXPR_NEG);
+		exp->lhs = operand;
+		return exp;
+	}
+
+	ast::Stmt* Analyser::newStmt(ast::StmtKind kind) {
+		auto stmt = _arena.New<ast::Stmt>();
+		stmt->kind = kind;
+		return stmt;
+	}
 	
 	void Analyser::unreadToken() {
 		if (_offset == 0)
 			DieAndPrint("analyser unreads token from the begining.");
-		_current_pos = _tokens[_offset - 1].GetEndPos();
+		if (_fetched - _offset >= kLookahead)
+			DieAndPrint("analyser unreads more tokens than the lookahead buffer holds.");
 		_offset--;
+		_current_offset = _ring[_offset % kLookahead].GetEnd();
+	}
+
+	std::pair<uint64_t, uint64_t> Analyser::currentPos() {
+		return _tokenizer.PosOf(_current_offset);
 	}
 
 	void Analyser::addConstantF(const Token& tk) {
-		ConstTable* me = new ConstTable;
+		ConstTable* me = _arena.New<ConstTable>();
 		me->type = 'S';
 		me->index = _nextConst;
-		_consts[tk.GetValueString()] = me;
+		me->name = tk.GetId();
+		_consts.Insert(tk.GetId(), me);
+		_constList.push_back(me);
 		_nextConst++;
 	}
 
-	ConstTable* Analyser::getConst(const std::string& s) {
-		return _consts[s];
+	ConstTable* Analyser::getConst(int32_t id) {
+		return _consts.Find(id);
 	}
 
 	void Analyser::addFunc(const Token& tk) {
-		Func* me = new Func;
+		Func* me = _arena.New<Func>();
 		me->type = 'S';
 		me->index = _nextFunc;
-		_funcs[tk.GetValueString()] = me;
+		me->name = tk.GetId();
+		_funcs.Insert(tk.GetId(), me);
+		_funcList.push_back(me);
 		_nextFunc++;
 	}
-	bool Analyser::isFunc(const std::string& s) {
-		return _funcs.find(s) != _funcs.end();
+	bool Analyser::isFunc(int32_t id) {
+		return _funcs.Contains(id);
 	}
-	Func* Analyser::getFunc(const std::string& s) {
-		return _funcs[s];
+	Func* Analyser::getFunc(int32_t id) {
+		return _funcs.Find(id);
 	}
 
-	// 获得 {变量，常量} 
-	Var* Analyser::getG(const std::string& s) {
-		return _gdt[s];
+	// 获得 {变量，常量}，不存在时返回 nullptr
+	Var* Analyser::getG(int32_t id) {
+		return _gdt.Find(id);
 	}
-	// 
-	Var* Analyser::getL(const std::string& s) {
-		return _ldt[s];
+	// 局部变量，不存在时返回 nullptr
+	Var* Analyser::getL(int32_t id) {
+		return _ldt.Find(id);
 	}
 	void Analyser::addGdt(const Token& tk) {
-		Var* me = new Var;
+		Var* me = _arena.New<Var>();
 		me->index = _nextGp;
 		if (tk.GetType() != TokenType::IDENTIFIER)
 			DieAndPrint("only identifier can be added to the table.");
 
-		_gdt[tk.GetValueString()] = me;
+		_gdt.Insert(tk.GetId(), me);
 		_nextGp++;
 	}
 	void Analyser::addLdt(const Token& tk) {
-		Var* me = new Var;
+		Var* me = _arena.New<Var>();
 		me->index = _nextLp;
 		if (tk.GetType() != TokenType::IDENTIFIER)
 			DieAndPrint("only identifier can be added to the table.");
-		_ldt[tk.GetValueString()] = me;
+		_ldt.Insert(tk.GetId(), me);
 		_nextLp++;
 	}
 	void Analyser::clrLdt() {
-		_ldt.clear();
+		_ldt.Clear();
 		_nextLp = 0;
 	}
-	bool Analyser::isConst(const std::string& s) {
-		if (_ldt.find(s) != _ldt.end())
-			return _ldt.at(s)->_const;
-		if (_ldt.find(s) != _ldt.end())
-			return _gdt.at(s)->_const;
+	// 局部变量遮蔽同名全局变量
+	Var* Analyser::getVar(int32_t id) {
+		Var* var = getL(id);
+		return var != nullptr ? var : getG(id);
 	}
-	bool Analyser::isInit(const std::string& s) {
-
-		if (_gdt.find(s) != _gdt.end())
-			return _gdt.at(s)->_init;
-		if (_ldt.find(s) != _ldt.end()){
-			return _ldt.at(s)->_init;
-		}
-		
-		
+	bool Analyser::isConst(int32_t id) {
+		Var* var = getVar(id);
+		return var != nullptr && var->_const;
+	}
+	bool Analyser::isInit(int32_t id) {
+		Var* var = getVar(id);
+		return var != nullptr && var->_init;
 	}
 
-	bool Analyser::isVoid(const std::string& s) {
-		if (_gdt.find(s) != _gdt.end()) {
-			if (_gdt.at(s)->type == 'v')
-				return true;
-		}
-		if (_ldt.find(s) != _ldt.end()) {
-			if (_ldt.at(s)->type == 'v')
-				return true;
-		}
-		
-		return false;
+	bool Analyser::isVoid(int32_t id) {
+		Var* var = getVar(id);
+		return var != nullptr && var->type == 'v';
 	}
-	bool Analyser::isDclr(const std::string& s) {
-		return _consts.find(s) == _consts.end() || _ldt.find(s) == _ldt.end() || _gdt.find(s) == _gdt.end();
+	bool Analyser::isDclr(int32_t id) {
+		return getVar(id) != nullptr;
 	}
-	bool Analyser::isClDclr(const std::string& s) {
-		return  _ldt.find(s) == _ldt.end() || _gdt.find(s) == _gdt.end();
+	bool Analyser::isClDclr(int32_t id) {
+		return getL(id) != nullptr;
 	}
 }
@@ -1,13 +1,20 @@
 #pragma once
 
 #include "error/error.h"
+#include "arena/arena.h"
 #include "instruction/instruction.h"
+#include "instruction/binary.h"
+#include "instruction/stack.h"
+#include "analyser/ast.h"
+#include "analyser/codegen.h"
+#include "analyser/symtab.h"
+#include "parallel/thread_pool.h"
 #include "tokenizer/token.h"
+#include "tokenizer/tokenizer.h"
 
 #include <vector>
 #include <optional>
 #include <utility>
-#include <map>
 #include <cstdint>
 #include <cstddef> // for std::size_t
 
@@ -18,28 +25,35 @@ namespace miniplc0 {
 		int32_t index;
 		bool	_const;
 		bool _init;
+		// 初值是编译期常量的 const 变量，引用时直接发出 _value
+		bool _known;
+		int32_t _value;
 	}Var;
-	typedef struct {
-		const char* _opr;
-		std::string _x;
-		std::string _y;
-	}Opr;
 
-	//value 在map中作为索引
+	//name 为驻留 id
 	typedef struct {
 		int32_t index;
+		int32_t name;
 		char16_t type;
 	}ConstTable;
 
 	typedef struct {
 		int32_t index;
+		int32_t name;
 		int32_t name_index;
 		int32_t num_par;
 		int32_t level;
 		char16_t type;
+		// 参数和局部变量占的槽数
+		int32_t num_local;
+		// 包括参数、局部变量在内的最大栈深度，两个字节放不下时为 kUnknownDepth
+		int32_t max_stack;
 		//std::vector<Var> pars;//参数在LDT中的索引
 	}Func;
 
+	// o0 函数表里 max_stack 的“未知”取值
+	constexpr std::int32_t kUnknownDepth = 0xffff;
+
 	class Analyser final {
 	private:
 		using uint64_t = std::uint64_t;
@@ -47,46 +61,56 @@ namespace miniplc0 {
 		using uint32_t = std::uint32_t;
 		using int32_t = std::int32_t;
 	public:
-		Analyser(std::vector<Token> v)
-			: _tokens(std::move(v)), _offset(0), _Sins({}), Sins({}), Ains({}), _current_pos(0, 0),
-			_gdt({}), _ldt({}), _consts({}), _nextGp(0), _nextLp(0) {}
+		// 边分析边从 tokenizer 取 token，不再先把所有 token 读进一个 vector。
+		// 给出 pool 时各个函数的代码生成在线程池上并行进行；给出 arena 时节点从它分配，由调用者负责 Reset
+		explicit Analyser(Tokenizer& tokenizer, ThreadPool* pool = nullptr, Arena* arena = nullptr)
+			: _ownedArena(), _arena(arena != nullptr ? *arena : _ownedArena), _interner(tokenizer.GetInterner()), _tokenizer(tokenizer), _pool(pool), _ring(), _fetched(0), _offset(0), _Sins({}), _current_offset(0),
+			_globals{ nullptr, nullptr }, _functions(), _Ains({}), _consts(), _funcs(), _gdt(), _ldt(), _nextGp(0), _nextLp(0),
+			_level(0), _const_flag(false), _type_flag(TokenType::CHAR), _now(nullptr) {}
 		Analyser(Analyser&&) = delete;
 		Analyser(const Analyser&) = delete;
 		Analyser& operator=(Analyser) = delete;
 
 		// 唯二接口
-		std::pair<std::vector<Opr*>, std::optional<CompilationError>> Analyse();
+		std::pair<std::vector<Instruction>, std::optional<CompilationError>> Analyse();
 
 		void printBinary(std::ostream& output);
 	private:
+		// 代码生成之后对每个函数做静态栈分析，填写 Func::max_stack
+		void computeStackDepths();
 		// 所有的递归子程序
 
 
 		std::optional<CompilationError> analyseC0Program();
-		std::optional<CompilationError> analyseVarDec();
-		std::optional<CompilationError> analyseInitDeclist();
-		std::optional<CompilationError> analyseInitDec();
+		std::optional<CompilationError> analyseVarDec(ast::StmtList& out);
+		std::optional<CompilationError> analyseInitDeclist(ast::StmtList& out);
+		std::optional<CompilationError> analyseInitDec(ast::StmtList& out);
 		std::optional<CompilationError> analyseFunDef();
-		std::optional<CompilationError> analyseExp();
-		std::optional<CompilationError> analyseAExp();
-		std::optional<CompilationError> analyseMExp();
-		std::optional<CompilationError> analyseUExp();
-		std::optional<CompilationError> analysePExp();
-		std::optional<CompilationError> analyseComp();
-		std::optional<CompilationError> analyseStmtSeq();
-		std::optional<CompilationError> analyseStmt();
-		std::optional<CompilationError> analyseLoopStmt();
+		std::optional<CompilationError> analyseExp(ast::Expr*& out);
+		std::optional<CompilationError> analyseAExp(ast::Expr*& out);
+		std::optional<CompilationError> analyseMExp(ast::Expr*& out);
+		std::optional<CompilationError> analyseUExp(ast::Expr*& out);
+		std::optional<CompilationError> analysePExp(ast::Expr*& out);
+		std::optional<CompilationError> analyseComp(ast::StmtList& out);
+		std::optional<CompilationError> analyseStmtSeq(ast::StmtList& out);
+		std::optional<CompilationError> analyseStmt(ast::StmtList& out);
+		std::optional<CompilationError> analyseLoopStmt(ast::StmtList& out);
 		std::optional<CompilationError> analyseForinitStmt();
-		std::optional<CompilationError> analyseJumpStmt();
-		std::optional<CompilationError> analysePrintStmt();
-		std::optional<CompilationError> analyseScanStmt();
+		std::optional<CompilationError> analyseJumpStmt(ast::StmtList& out);
+		std::optional<CompilationError> analysePrintStmt(ast::StmtList& out);
+		std::optional<CompilationError> analyseScanStmt(ast::StmtList& out);
 		std::optional<CompilationError> analysePar();
 		std::optional<CompilationError> analysePDL();
 		std::optional<CompilationError> analysePD();
-		std::optional<CompilationError> analyseFunCall();
-		void binary2byte(int number, std::ostream& output);
-		void binary4byte(int number, std::ostream& output);
-		void printBinaryInstruction(Opr* opr, std::ostream& output);
+		std::optional<CompilationError> analyseFunCall(ast::Expr*& out);
+
+		// 语法树节点，都从 _arena 分配
+		ast::Expr* newExpr(ast::ExprKind kind);
+		ast::Expr* newInt(int32_t value);
+		// 两个操作数都是字面量时就地折叠
+		ast::Expr* newBinary(Operation opr, ast::Expr* lhs, ast::Expr* rhs);
+		ast::Expr* newNeg(ast::Expr* operand);
+		ast::Stmt* newStmt(ast::StmtKind kind);
 
 
 		// Token 缓冲区相关操作
@@ -95,6 +119,8 @@ namespace miniplc0 {
 		std::optional<Token> nextToken();
 		// 回退一个 token
 		void unreadToken();
+		// 最近读到的 token 的结束位置（行, 列）
+		std::pair<uint64_t, uint64_t> currentPos();
 
 		// 下面是符号表相关操作
 
@@ -107,48 +133,78 @@ namespace miniplc0 {
 		// 是否是已初始化的变量
 		// 是否是常量
 		// 是否是常量
-		bool isConst(const std::string& s);
-		bool isInit(const std::string& s);
-		bool isVoid(const std::string& s);
-		bool isDclr(const std::string& s);
-		bool isClDclr(const std::string& s);
+		bool isConst(int32_t id);
+		bool isInit(int32_t id);
+		bool isVoid(int32_t id);
+		bool isDclr(int32_t id);
+		bool isClDclr(int32_t id);
 		void addFunc(const Token& tk);
-		Func* getFunc(const std::string& s);
-		ConstTable* getConst(const std::string& s);
+		Func* getFunc(int32_t id);
+		ConstTable* getConst(int32_t id);
 		void addConstantF(const Token& tk);
-		std::optional<CompilationError> analyseCond();
-		std::optional<CompilationError> analyseCondStmt();
-		std::optional<CompilationError> analyseExpl();
-		std::optional<CompilationError> analysePrint();
-		bool isFunc(const std::string&);
+		std::optional<CompilationError> analyseCond(ast::Cond*& out);
+		std::optional<CompilationError> analyseCondStmt(ast::StmtList& out);
+		std::optional<CompilationError> analyseExpl(ast::Expr*& first);
+		std::optional<CompilationError> analysePrint(ast::Expr*& first);
+		bool isFunc(int32_t id);
 		// 获得 {变量，常量} 在全局栈上的偏移
-		Var* getG(const std::string&);
+		Var* getG(int32_t id);
 
 		// 获得 {变量，常量} 在局部栈上的偏移
-		Var* getL(const std::string&);
+		Var* getL(int32_t id);
+		// 先查局部再查全局
+		Var* getVar(int32_t id);
 
 	public:
-		std::vector<Token> _tokens;
+		// 没有传入 arena 时使用自己的
+		Arena _ownedArena;
+		// 符号表中的 Var、Func、ConstTable 和语法树都从这里分配
+		Arena& _arena;
+		StringInterner& _interner;
+		Tokenizer& _tokenizer;
+		ThreadPool* _pool;
+		// 最近取到的 kLookahead 个 token，第 i 个 token 存放在 _ring[i % kLookahead]。
+		// 文法最多连续回退 3 个 token，留足余量
+		static constexpr std::size_t kLookahead = 8;
+		Token _ring[kLookahead];
+		// 已经从 tokenizer 取到的 token 数
+		std::size_t _fetched;
+		// 下一个要返回的 token 的序号，回退时减一
 		std::size_t _offset;
+		// tokenizer 报告的错误（EOF 除外），由 Analyse 优先返回
+		std::optional<CompilationError> _lex_error;
 		std::vector<Instruction> _Sins;
-		std::pair<uint64_t, uint64_t> _current_pos;
-		// 函数名 -> 对应的指令集
-		std::map <std::string, std::vector<Instruction>> _Ains;
-
-
-		//std::string-> identifier
-		std::map <std::string, ConstTable*> _consts;
-		std::vector<Opr*> Sins;
-		std::map<std::string, std::vector<Opr*>> Ains;
-		std::map <std::string, Func*> _funcs;
-		std::map <std::string, Var*> _gdt;
-		std::map <std::string, Var*> _ldt;
+		uint64_t _current_offset;
+		// 全局变量声明，生成 .start
+		ast::StmtList _globals;
+		// 按定义顺序排列的函数
+		std::vector<ast::Function> _functions;
+		// 函数下标 -> 对应的指令集
+		std::vector<std::vector<Instruction>> _Ains;
+
+
+		// 以下符号表均以标识符的驻留 id 为键
+		SymbolTable<ConstTable> _consts;
+		SymbolTable<Func> _funcs;
+		// 同样的对象按下标顺序排列，输出时顺序遍历即可
+		std::vector<ConstTable*> _constList;
+		std::vector<Func*> _funcList;
+		SymbolTable<Var> _gdt;
+		SymbolTable<Var> _ldt;
 		int32_t _nextGp = 0;
 		int32_t _nextLp = 0;
 		int32_t _nextConst = 0;
 		int32_t _nextVar = 0;
 		int32_t _nextFunc = 0;
 
-
+		// 分析状态，每个 Analyser 各有一份，互不干扰
+		// 0 为全局声明，1 为函数内
+		int32_t _level;
+		// 正在分析 const 声明
+		bool _const_flag;
+		// 最近的类型说明符
+		TokenType _type_flag;
+		// 正在分析的函数
+		Func* _now;
 	};
 }
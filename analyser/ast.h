@@ -0,0 +1,103 @@
+#pragma once
+
+#include "instruction/instruction.h"
+
+#include <cstdint>
+
+namespace miniplc0 {
+
+	// 语法分析的产物。所有节点都从 Analyser 的 arena 中分配，平凡析构，随 Analyser 一起释放。
+	// 标识符在分析时已经解析成槽位和函数下标，代码生成不再查符号表。
+	namespace ast {
+
+		enum ExprKind : std::uint8_t {
+			// 空表达式（比如 return; 和 print() 的参数），不生成任何代码
+			EXPR_EMPTY,
+			EXPR_INT,
+			EXPR_VAR,
+			EXPR_NEG,
+			EXPR_BINARY,
+			EXPR_CALL
+		};
+
+		typedef struct Expr {
+			ExprKind kind;
+			// BINARY 的运算：iadd、isub、imul、idiv
+			Operation op;
+			// INT 为值，VAR 为槽位，CALL 为函数下标
+			std::int32_t value;
+			// VAR 的 loada 层次差
+			std::int32_t level;
+			// BINARY 的两个操作数，NEG 只用 lhs，CALL 的 lhs 为第一个实参
+			struct Expr* lhs;
+			struct Expr* rhs;
+			// 实参链表
+			struct Expr* next;
+		}Expr;
+
+		// if / while 的条件：lhs 为假时跳走，或者比较 lhs 和 rhs 后用 jump 跳走
+		typedef struct {
+			Expr* lhs;
+			Expr* rhs;
+			bool compare;
+			// 条件不成立时的跳转
+			Operation jump;
+		}Cond;
+
+		enum StmtKind : std::uint8_t {
+			// 单独的分号
+			STMT_EMPTY,
+			// 变量声明，初值留在栈上就是这个变量的槽
+			STMT_DECL,
+			STMT_ASSIGN,
+			// 作为语句的函数调用，被调用者返回 int 时随后弹出返回值
+			STMT_CALL,
+			STMT_SCAN,
+			STMT_PRINT,
+			STMT_RETURN,
+			STMT_IF,
+			STMT_WHILE,
+			STMT_DO,
+			STMT_BLOCK
+		};
+
+		typedef struct Stmt {
+			StmtKind kind;
+			// RETURN 是否带返回值（iret），CALL 的被调用者是否返回 int，IF 是否有 else
+			bool value;
+			// ASSIGN、SCAN 的目标：loada 的层次差和槽位
+			std::int32_t level;
+			std::int32_t slot;
+			// DECL 的初值、ASSIGN 的右值、CALL 的调用、RETURN 的返回值、PRINT 的第一个参数
+			Expr* exp;
+			Cond* cond;
+			// IF 的两个分支；WHILE、DO 的循环体和 BLOCK 的内容放在 then。都是语句链表，可以为空
+			struct Stmt* then;
+			struct Stmt* other;
+			struct Stmt* next;
+		}Stmt;
+
+		// 语句链表，追加时不用遍历
+		typedef struct {
+			Stmt* head;
+			Stmt* tail;
+		}StmtList;
+
+		inline void Append(StmtList& list, Stmt* stmt) {
+			if (list.tail == nullptr)
+				list.head = stmt;
+			else
+				list.tail->next = stmt;
+			list.tail = stmt;
+		}
+
+		typedef struct {
+			// 函数表中的下标
+			std::int32_t index;
+			// 返回 int：走到函数末尾时返回 0，使每条返回路径都留下一个值
+			bool value;
+			// 函数体：局部变量声明在前，语句在后
+			Stmt* body;
+		}Function;
+	}
+}
@@ -0,0 +1,172 @@
+#include "analyser/codegen.h"
+#include "instruction/peephole.h"
+
+namespace miniplc0 {
+
+	void Codegen::GenStart(const ast::Stmt* globals, std::vector<Instruction>& out) {
+		_code = &out;
+		genStmts(globals);
+		finish();
+	}
+
+	void Codegen::GenFunction(const ast::Function& function, std::vector<Instruction>& out) {
+		_code = &out;
+		genStmts(function.body);
+		if (function.value) {
+			emit(Operation::ipush, 0);
+			emit(Operation::iret);
+		}
+		else
+			emit(Operation::ret);
+		finish();
+	}
+
+	void Codegen::genStmts(const ast::Stmt* first) {
+		for (auto s = first; s != nullptr; s = s->next)
+			genStmt(s);
+	}
+
+	void Codegen::genStmt(const ast::Stmt* stmt) {
+		switch (stmt->kind) {
+		case ast::STMT_EMPTY:
+			emit(Operation::nop);
+			break;
+		case ast::STMT_DECL:
+			genExpr(stmt->exp);
+			break;
+		case ast::STMT_CALL:
+			// 丢掉用不到的返回值，循环里的调用才不会让栈越来越深
+			genExpr(stmt->exp);
+			if (stmt->value)
+				emit(Operation::pop);
+			break;
+		case ast::STMT_ASSIGN:
+			emit(Operation::loada, stmt->level, stmt->slot);
+			genExpr(stmt->exp);
+			emit(Operation::istore);
+			break;
+		case ast::STMT_SCAN:
+			emit(Operation::loada, stmt->level, stmt->slot);
+			emit(Operation::iscan);
+			emit(Operation::istore);
+			break;
+		case ast::STMT_PRINT:
+			// 参数之间用空格隔开
+			for (auto e = stmt->exp; e != nullptr; e = e->next) {
+				genExpr(e);
+				emit(Operation::iprint);
+				if (e->next == nullptr)
+					break;
+				emit(Operation::bipush, 32);
+				emit(Operation::cprint);
+			}
+			emit(Operation::printl);
+			break;
+		case ast::STMT_RETURN:
+			genExpr(stmt->exp);
+			emit(stmt->value ? Operation::iret : Operation::ret);
+			break;
+		case ast::STMT_IF: {
+			auto else_label = newLabel();
+			genCond(stmt->cond, else_label);
+			genStmts(stmt->then);
+			if (stmt->value) {
+				auto end_label = newLabel();
+				emitJump(Operation::jmp, end_label);
+				bindLabel(else_label);
+				genStmts(stmt->other);
+				bindLabel(end_label);
+			}
+			else
+				bindLabel(else_label);
+			break;
+		}
+		case ast::STMT_WHILE:
+		case ast::STMT_DO: {
+			//循环之起始位置
+			auto xhqs = newLabel();
+			auto end_label = newLabel();
+			bindLabel(xhqs);
+			if (stmt->kind == ast::STMT_WHILE) {
+				genCond(stmt->cond, end_label);
+				genStmts(stmt->then);
+			}
+			else {
+				genStmts(stmt->then);
+				genCond(stmt->cond, end_label);
+			}
+			emitJump(Operation::jmp, xhqs);
+			bindLabel(end_label);
+			break;
+		}
+		case ast::STMT_BLOCK:
+			genStmts(stmt->then);
+			break;
+		}
+	}
+
+	void Codegen::genExpr(const ast::Expr* exp) {
+		switch (exp->kind) {
+		case ast::EXPR_EMPTY:
+			break;
+		case ast::EXPR_INT:
+			emit(Operation::ipush, exp->value);
+			break;
+		case ast::EXPR_VAR:
+			emit(Operation::loada, exp->level, exp->value);
+			emit(Operation::iload);
+			break;
+		case ast::EXPR_NEG:
+			genExpr(exp->lhs);
+			emit(Operation::ineg);
+			break;
+		case ast::EXPR_BINARY:
+			genExpr(exp->lhs);
+			genExpr(exp->rhs);
+			emit(exp->op);
+			break;
+		case ast::EXPR_CALL:
+			for (auto e = exp->lhs; e != nullptr; e = e->next)
+				genExpr(e);
+			emit(Operation::call, exp->value);
+			break;
+		}
+	}
+
+	void Codegen::genCond(const ast::Cond* cond, int32_t false_label) {
+		genExpr(cond->lhs);
+		if (cond->compare) {
+			genExpr(cond->rhs);
+			emit(Operation::icmp);
+		}
+		emitJump(cond->jump, false_label);
+	}
+
+	void Codegen::emit(Operation opr, int32_t x, int32_t y) {
+		_code->emplace_back(opr, x, y);
+	}
+
+	int32_t Codegen::newLabel() {
+		_labels.push_back(-1);
+		return _labels.size() - 1;
+	}
+
+	void Codegen::bindLabel(int32_t label) {
+		_labels[label] = _code->size();
+	}
+
+	void Codegen::emitJump(Operation opr, int32_t label) {
+		_fixups.emplace_back(_code->size(), label);
+		emit(opr, label);
+	}
+
+	void Codegen::finish() {
+		auto& ins = *_code;
+		for (auto& fix : _fixups)
+			ins[fix.first].SetX(_labels[fix.second]);
+		_fixups.clear();
+		_labels.clear();
+		Peephole(ins);
+		_code = nullptr;
+	}
+}
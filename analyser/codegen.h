@@ -0,0 +1,47 @@
+#pragma once
+
+#include "analyser/ast.h"
+#include "instruction/instruction.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 把 AST 翻译成指令流。每次 Gen 只依赖传进来的节点，互不影响，
+	// 生成完成后跳转已经回填成指令下标并做过窥孔优化。
+	class Codegen final {
+	private:
+		using int32_t = std::int32_t;
+	public:
+		Codegen() : _code(nullptr), _labels(), _fixups() {}
+		Codegen(Codegen&&) = delete;
+		Codegen(const Codegen&) = delete;
+		Codegen& operator=(Codegen) = delete;
+
+		// 全局变量的初始化代码，即 .start
+		void GenStart(const ast::Stmt* globals, std::vector<Instruction>& out);
+		void GenFunction(const ast::Function& function, std::vector<Instruction>& out);
+	private:
+		// 依次生成 first 开始的语句链表
+		void genStmts(const ast::Stmt* first);
+		void genStmt(const ast::Stmt* stmt);
+		void genExpr(const ast::Expr* exp);
+		void genCond(const ast::Cond* cond, int32_t false_label);
+		void emit(Operation opr, int32_t x = 0, int32_t y = 0);
+
+		// 跳转标签：跳转先以标签号作为目标发出，结束时一次性回填
+		int32_t newLabel();
+		// 把标签绑定到下一条将要发出的指令
+		void bindLabel(int32_t label);
+		void emitJump(Operation opr, int32_t label);
+		void finish();
+	private:
+		std::vector<Instruction>* _code;
+		// 标签位置（-1 表示尚未绑定）与待回填的跳转
+		std::vector<int32_t> _labels;
+		std::vector<std::pair<std::size_t, int32_t>> _fixups;
+	};
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 以驻留 id 为键的开放寻址（线性探测）符号表，值为指向 arena 中对象的指针。
+	// 查找失败不会插入任何东西。
+	template<typename T>
+	class SymbolTable final {
+	private:
+		using int32_t = std::int32_t;
+		using uint32_t = std::uint32_t;
+
+		struct Slot {
+			int32_t key;
+			T* value;
+		};
+	public:
+		explicit SymbolTable(std::size_t capacity = 16) : _slots(roundUp(capacity), Slot{ -1, nullptr }), _size(0) {}
+
+		T* Find(int32_t key) const {
+			auto mask = _slots.size() - 1;
+			for (auto i = hash(key) & mask;; i = (i + 1) & mask) {
+				auto& slot = _slots[i];
+				if (slot.key == key)
+					return slot.value;
+				if (slot.key < 0)
+					return nullptr;
+			}
+		}
+
+		bool Contains(int32_t key) const { return Find(key) != nullptr; }
+
+		// 已存在时覆盖
+		void Insert(int32_t key, T* value) {
+			if ((_size + 1) * 2 > _slots.size())
+				grow();
+			auto mask = _slots.size() - 1;
+			for (auto i = hash(key) & mask;; i = (i + 1) & mask) {
+				auto& slot = _slots[i];
+				if (slot.key == key) {
+					slot.value = value;
+					return;
+				}
+				if (slot.key < 0) {
+					slot = Slot{ key, value };
+					_size++;
+					return;
+				}
+			}
+		}
+
+		void Clear() {
+			if (_size == 0)
+				return;
+			for (auto& slot : _slots)
+				slot = Slot{ -1, nullptr };
+			_size = 0;
+		}
+
+		std::size_t Size() const { return _size; }
+
+		// 按槽位顺序遍历 (key, value)
+		template<typename F>
+		void ForEach(F f) const {
+			for (auto& slot : _slots)
+				if (slot.key >= 0)
+					f(slot.key, slot.value);
+		}
+	private:
+		static std::size_t roundUp(std::size_t n) {
+			std::size_t c = 8;
+			while (c < n)
+				c <<= 1;
+			return c;
+		}
+
+		static uint32_t hash(int32_t key) {
+			// id 是稠密的，乘法散列把相邻的 id 打散
+			return static_cast<uint32_t>(key) * 2654435761u;
+		}
+
+		void grow() {
+			std::vector<Slot> old(_slots.size() * 2, Slot{ -1, nullptr });
+			old.swap(_slots);
+			_size = 0;
+			for (auto& slot : old)
+				if (slot.key >= 0)
+					Insert(slot.key, slot.value);
+		}
+	private:
+		std::vector<Slot> _slots;
+		std::size_t _size;
+	};
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 线性（bump）分配器：对象从少数几个大块中切出，随 Arena 一起整体释放。
+	// 只用于平凡析构的对象，析构函数不会被调用。
+	class Arena final {
+	private:
+		using size_t = std::size_t;
+
+		struct Block {
+			std::unique_ptr<char[]> data;
+			size_t size;
+		};
+	public:
+		explicit Arena(size_t block_size = 64 * 1024)
+			: _block_size(block_size), _blocks(), _current(0), _ptr(nullptr), _end(nullptr) {}
+		Arena(Arena&&) = delete;
+		Arena(const Arena&) = delete;
+		Arena& operator=(Arena) = delete;
+
+		void* Allocate(size_t size, size_t align) {
+			auto p = alignUp(_ptr, align);
+			if (_ptr == nullptr || p + size > _end) {
+				nextBlock(size + align);
+				p = alignUp(_ptr, align);
+			}
+			_ptr = p + size;
+			return p;
+		}
+
+		template<typename T, typename... Args>
+		T* New(Args&&... args) {
+			static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destructed");
+			return new (Allocate(sizeof(T), alignof(T))) T{ std::forward<Args>(args)... };
+		}
+
+		// 回收所有对象，但保留已经申请的块以便复用
+		void Reset() {
+			_current = 0;
+			if (_blocks.empty()) {
+				_ptr = _end = nullptr;
+				return;
+			}
+			_ptr = _blocks[0].data.get();
+			_end = _ptr + _blocks[0].size;
+		}
+
+		// 已经向系统申请的字节数
+		size_t Reserved() const {
+			size_t total = 0;
+			for (auto& b : _blocks)
+				total += b.size;
+			return total;
+		}
+	private:
+		static char* alignUp(char* p, size_t align) {
+			auto v = reinterpret_cast<std::uintptr_t>(p);
+			return reinterpret_cast<char*>((v + align - 1) & ~(std::uintptr_t)(align - 1));
+		}
+
+		void nextBlock(size_t need) {
+			// Reset 之后优先复用足够大的旧块
+			while (_ptr != nullptr && _current + 1 < _blocks.size()) {
+				_current++;
+				if (_blocks[_current].size >= need) {
+					_ptr = _blocks[_current].data.get();
+					_end = _ptr + _blocks[_current].size;
+					return;
+				}
+			}
+			auto size = need > _block_size ? need : _block_size;
+			_blocks.push_back(Block{ std::unique_ptr<char[]>(new char[size]), size });
+			_current = _blocks.size() - 1;
+			_ptr = _blocks[_current].data.get();
+			_end = _ptr + size;
+		}
+	private:
+		size_t _block_size;
+		std::vector<Block> _blocks;
+		size_t _current;
+		char* _ptr;
+		char* _end;
+	};
+}
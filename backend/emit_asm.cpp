@@ -0,0 +1,665 @@
+#include "backend/emit_asm.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace miniplc0 {
+
+	namespace {
+
+		// 附带的运行时：缓冲输出、读整数和陷入，只用 read/write/getrlimit/exit_group 四个系统调用。
+		// 除 c0_trap 外都只破坏调用者保存的寄存器
+		const char* const kRuntime = R"(
+	.bss
+	.align 16
+c0_outbuf:	.zero 4096
+c0_inbuf:	.zero 4096
+c0_outlen:	.zero 8
+c0_inpos:	.zero 8
+c0_inlen:	.zero 8
+c0_frames:	.zero 4
+c0_stack_limit:	.zero 8
+c0_rlimit:	.zero 16
+
+	.section .rodata
+c0_e_VMNoMain:	.asciz "VMNoMain"
+c0_e_VMBadJump:	.asciz "VMBadJump"
+c0_e_VMStackOverflow:	.asciz "VMStackOverflow"
+c0_e_VMStackUnderflow:	.asciz "VMStackUnderflow"
+c0_e_VMDivideByZero:	.asciz "VMDivideByZero"
+c0_e_VMIntegerOverflow:	.asciz "VMIntegerOverflow"
+c0_e_VMBadInput:	.asciz "VMBadInput"
+c0_s_err:	.asciz "Err at "
+c0_s_start:	.asciz ".start"
+c0_s_f:	.asciz ".F"
+
+	.text
+# 记下机器栈的下限：离入口处的 rsp 为 RLIMIT_STACK 的软限制（取不到时 8 MiB，无限或更大时 1 GiB），
+# 再留出 64 KiB 给运行时和陷入。每次调用前检查被调用者的帧建好之后不低于这个下限
+c0_stack_init:
+	movl $97, %eax
+	movl $3, %edi
+	leaq c0_rlimit(%rip), %rsi
+	syscall
+	movl $0x800000, %ecx
+	testq %rax, %rax
+	jnz 1f
+	movq c0_rlimit(%rip), %rcx
+	movl $0x40000000, %eax
+	cmpq %rax, %rcx
+	jbe 1f
+	movq %rax, %rcx
+1:	subq $0x10000, %rcx
+	jae 2f
+	xorl %ecx, %ecx
+2:	movq %rsp, %rax
+	subq %rcx, %rax
+	movq %rax, c0_stack_limit(%rip)
+	ret
+
+# 把输出缓冲写到 fd %edi 并清空
+c0_write:
+	leaq c0_outbuf(%rip), %rsi
+	movq c0_outlen(%rip), %rdx
+1:	testq %rdx, %rdx
+	jle 2f
+	movl $1, %eax
+	syscall
+	testq %rax, %rax
+	jle 2f
+	addq %rax, %rsi
+	subq %rax, %rdx
+	jmp 1b
+2:	movq $0, c0_outlen(%rip)
+	ret
+
+c0_flush:
+	movl $1, %edi
+	jmp c0_write
+
+# 输出 %dil
+c0_putc:
+	movq c0_outlen(%rip), %rax
+	cmpq $4096, %rax
+	jb 1f
+	pushq %rdi
+	call c0_flush
+	popq %rdi
+	xorl %eax, %eax
+1:	leaq c0_outbuf(%rip), %rcx
+	movb %dil, (%rcx,%rax)
+	incq %rax
+	movq %rax, c0_outlen(%rip)
+	ret
+
+# 输出 %rdi 指向的以 0 结尾的字符串
+c0_puts:
+	pushq %rbx
+	movq %rdi, %rbx
+1:	movzbl (%rbx), %edi
+	testl %edi, %edi
+	jz 2f
+	call c0_putc
+	incq %rbx
+	jmp 1b
+2:	popq %rbx
+	ret
+
+# 以十进制输出 %edi
+c0_iprint:
+	pushq %rbx
+	pushq %r12
+	subq $40, %rsp
+	movslq %edi, %rax
+	movq %rax, 32(%rsp)
+	testq %rax, %rax
+	jns 1f
+	movl $45, %edi
+	call c0_putc
+	movq 32(%rsp), %rax
+	negq %rax
+1:	leaq 32(%rsp), %r12
+	movq %r12, %rbx
+	movl $10, %ecx
+2:	xorl %edx, %edx
+	divq %rcx
+	addb $48, %dl
+	decq %rbx
+	movb %dl, (%rbx)
+	testq %rax, %rax
+	jnz 2b
+3:	movzbl (%rbx), %edi
+	call c0_putc
+	incq %rbx
+	cmpq %r12, %rbx
+	jb 3b
+	addq $40, %rsp
+	popq %r12
+	popq %rbx
+	ret
+
+# 下一个输入字节，不消耗；文件结束时为 -1
+c0_peek:
+	movq c0_inpos(%rip), %rax
+	cmpq c0_inlen(%rip), %rax
+	jb 1f
+	xorl %eax, %eax
+	xorl %edi, %edi
+	leaq c0_inbuf(%rip), %rsi
+	movl $4096, %edx
+	syscall
+	testq %rax, %rax
+	jle 2f
+	movq %rax, c0_inlen(%rip)
+	movq $0, c0_inpos(%rip)
+	xorl %eax, %eax
+1:	leaq c0_inbuf(%rip), %rcx
+	movzbl (%rcx,%rax), %eax
+	ret
+2:	movl $-1, %eax
+	ret
+
+# 读一个 32 位整数到 %eax，格式和 istream >> int 相同。失败时以 (%edi, %esi) 陷入
+c0_iscan:
+	pushq %rbx
+	pushq %r12
+	pushq %r13
+	pushq %r14
+	pushq %r15
+	movl %edi, %ebx
+	movl %esi, %r12d
+1:	call c0_peek
+	cmpl $32, %eax
+	je 2f
+	cmpl $9, %eax
+	jl 3f
+	cmpl $13, %eax
+	jg 3f
+2:	incq c0_inpos(%rip)
+	jmp 1b
+3:	xorl %r13d, %r13d
+	cmpl $45, %eax
+	jne 4f
+	movl $1, %r13d
+	incq c0_inpos(%rip)
+	jmp 5f
+4:	cmpl $43, %eax
+	jne 5f
+	incq c0_inpos(%rip)
+5:	xorl %r14d, %r14d
+	xorl %r15d, %r15d
+6:	call c0_peek
+	subl $48, %eax
+	cmpl $9, %eax
+	ja 7f
+	incq c0_inpos(%rip)
+	incl %r15d
+	imulq $10, %r14, %r14
+	addq %rax, %r14
+	movl $0x80000000, %ecx
+	cmpq %rcx, %r14
+	ja 8f
+	jmp 6b
+7:	testl %r15d, %r15d
+	jz 8f
+	testl %r13d, %r13d
+	jz 9f
+	negq %r14
+	jmp 10f
+9:	movl $0x7fffffff, %ecx
+	cmpq %rcx, %r14
+	ja 8f
+10:	movl %r14d, %eax
+	popq %r15
+	popq %r14
+	popq %r13
+	popq %r12
+	popq %rbx
+	ret
+8:	movl %ebx, %edi
+	movl %r12d, %esi
+	leaq c0_e_VMBadInput(%rip), %rdx
+	jmp c0_trap
+
+# 运行时错误：函数 %edi（-1 为 .start），指令 %esi，错误名 %rdx。不返回
+c0_trap:
+	movl %edi, %ebx
+	movl %esi, %r12d
+	movq %rdx, %r13
+	call c0_flush
+	leaq c0_s_err(%rip), %rdi
+	call c0_puts
+	testl %ebx, %ebx
+	jns 1f
+	leaq c0_s_start(%rip), %rdi
+	call c0_puts
+	jmp 2f
+1:	leaq c0_s_f(%rip), %rdi
+	call c0_puts
+	movl %ebx, %edi
+	call c0_iprint
+2:	movl $58, %edi
+	call c0_putc
+	movl %r12d, %edi
+	call c0_iprint
+	movl $58, %edi
+	call c0_putc
+	movl $9, %edi
+	call c0_putc
+	movq %r13, %rdi
+	call c0_puts
+	movl $10, %edi
+	call c0_putc
+	movl $2, %edi
+	call c0_write
+	movl $231, %eax
+	movl $3, %edi
+	syscall
+)";
+
+		// 放栈槽 0-4 的寄存器，都是被调用者保存的
+		const char* const kSlotRegs[] = { "%ebx", "%r12d", "%r13d", "%r14d", "%r15d" };
+		const char* const kSavedRegs[] = { "%rbx", "%r12", "%r13", "%r14", "%r15" };
+		const std::int32_t kRegSlots = 5;
+		// System V 前六个整数参数
+		const char* const kArgRegs[] = { "%edi", "%esi", "%edx", "%ecx", "%r8d", "%r9d" };
+		const std::int32_t kArgRegCount = 6;
+
+		// 最大栈深度为 max 的函数帧：保存几个寄存器，局部区多少字节。建好之后 rsp 按 16 对齐
+		void frameLayout(std::int32_t max, std::int32_t& saved, std::int32_t& frame) {
+			saved = max < kRegSlots ? max : kRegSlots;
+			frame = max > kRegSlots ? 4 * (max - kRegSlots) : 0;
+			frame = (frame + 7) / 8 * 8;
+			if ((8 * saved + frame) % 16 != 0)
+				frame += 8;
+		}
+
+		bool isCondJump(Operation opr) {
+			return IsJump(opr) && opr != Operation::jmp;
+		}
+
+		// 和 0 比较或者 icmp 两个操作数比较之后的跳转
+		const char* jumpMnemonic(Operation opr) {
+			switch (opr) {
+			case Operation::je: return "je";
+			case Operation::jne: return "jne";
+			case Operation::jl: return "jl";
+			case Operation::jge: return "jge";
+			case Operation::jg: return "jg";
+			default: return "jle";
+			}
+		}
+
+		class AsmEmitter final {
+		private:
+			using int32_t = std::int32_t;
+			using size_t = std::size_t;
+
+			typedef struct {
+				const char* err;
+				int32_t pc;
+			}TrapSite;
+		public:
+			AsmEmitter(const Program& program, std::ostream& out)
+				: _program(program), _out(out), _callees(GetCallTargets(program)), _frame_sizes(), _globals(0), _fn(-1), _saved(0),
+				_traps() {}
+
+			std::optional<std::string> Emit();
+		private:
+			std::optional<std::string> function(int32_t fn, const std::vector<Instruction>& code, const StackAnalysis& st);
+			void body(const std::vector<Instruction>& code, const StackAnalysis& st);
+			// 当前单元第 k 个栈槽的操作数。.start 的帧就是全局变量
+			std::string slot(int32_t k) const;
+			std::string var(const StackSlot& a) const;
+			std::string label(size_t i) const;
+			void move(const std::string& dst, const std::string& src);
+			// 条件满足时跳到陷入桩
+			void trap(const char* jcc, const char* err, size_t pc);
+			void ins(const std::string& text) { _out << "\t" << text << "\n"; }
+		private:
+			const Program& _program;
+			std::ostream& _out;
+			std::vector<CallTarget> _callees;
+			// 每个函数的帧从返回地址算起占多少字节
+			std::vector<int32_t> _frame_sizes;
+			int32_t _globals;
+			int32_t _fn;
+			// 当前函数保存了几个寄存器
+			int32_t _saved;
+			std::vector<TrapSite> _traps;
+		};
+
+		std::optional<std::string> AsmEmitter::Emit() {
+			auto& start = *_program.start;
+			StackAnalysis st;
+			auto bad = st.Run(start, 0, 0, _callees);
+			if (bad.has_value())
+				return DescribeUnsupported(-1, bad.value(), "assembly");
+			if (st.Reachable(start.size()))
+				_globals = st.Depth(start.size());
+
+			_out << "# generated by cc0 --emit-asm\n" << kRuntime;
+			_out << "\n\t.bss\n\t.align 4\nc0_g:\t.zero " << 4 * (st.MaxDepth() > 0 ? st.MaxDepth() : 1) << "\n\n\t.text\n";
+			// 调用处要知道被调用者的帧有多大，先把所有函数分析完
+			auto n = _program.functions.size();
+			std::vector<StackAnalysis> fs(n);
+			_frame_sizes.assign(n, 0);
+			for (int32_t f = 0; f < (int32_t)n; f++) {
+				auto& func = _program.functions[f];
+				bad = fs[f].Run(*func.code, func.num_par, func.level, _callees);
+				if (bad.has_value())
+					return DescribeUnsupported(f, bad.value(), "assembly");
+				int32_t saved, frame;
+				frameLayout(fs[f].MaxDepth(), saved, frame);
+				_frame_sizes[f] = 16 + 8 * saved + frame;
+			}
+
+			auto err = function(-1, start, st);
+			if (err.has_value())
+				return err;
+			for (int32_t f = 0; f < (int32_t)n; f++) {
+				_out << "\n# " << _program.functions[f].name << "\n";
+				err = function(f, *_program.functions[f].code, fs[f]);
+				if (err.has_value())
+					return err;
+			}
+
+			// 和 cc0-vm 一样先执行 .start，再找 main；main 的参数取自全局变量的末尾
+			_out << "\n\t.globl _start\n_start:\n";
+			ins("movl $1, c0_frames(%rip)");
+			ins("call c0_stack_init");
+			ins("call c0_start");
+			_fn = -1;
+			int32_t main = -1;
+			for (int32_t f = 0; f < (int32_t)_program.functions.size() && main < 0; f++)
+				if (_program.functions[f].name == "main")
+					main = f;
+			if (main < 0) {
+				ins("movl $-1, %edi");
+				ins("xorl %esi, %esi");
+				ins("leaq c0_e_VMNoMain(%rip), %rdx");
+				ins("jmp c0_trap");
+			}
+			else if (_program.functions[main].num_par > _globals) {
+				ins("movl $" + std::to_string(main) + ", %edi");
+				ins("xorl %esi, %esi");
+				ins("leaq c0_e_VMStackUnderflow(%rip), %rdx");
+				ins("jmp c0_trap");
+			}
+			else {
+				auto np = _program.functions[main].num_par;
+				auto stacked = np > kArgRegCount ? np - kArgRegCount : 0;
+				if (stacked % 2 != 0)
+					ins("subq $8, %rsp");
+				for (auto k = np - 1; k >= kArgRegCount; k--) {
+					ins("movl " + slot(_globals - np + k) + ", %eax");
+					ins("pushq %rax");
+				}
+				for (int32_t k = 0; k < np && k < kArgRegCount; k++)
+					ins("movl " + slot(_globals - np + k) + ", " + kArgRegs[k]);
+				ins("call c0_F" + std::to_string(main));
+				ins("call c0_flush");
+				ins("movl $231, %eax");
+				ins("xorl %edi, %edi");
+				ins("syscall");
+			}
+			// 不需要可执行的栈
+			_out << "\n\t.section .note.GNU-stack,\"\",@progbits\n";
+			return {};
+		}
+
+		std::optional<std::string> AsmEmitter::function(int32_t fn, const std::vector<Instruction>& code, const StackAnalysis& st) {
+			_fn = fn;
+			_traps.clear();
+			auto max = st.MaxDepth();
+			int32_t frame = 0;
+			_saved = 0;
+			if (fn >= 0)
+				frameLayout(max, _saved, frame);
+
+			// 全局变量只有 .start 留下的那些
+			if (fn >= 0) {
+				auto bad = st.GlobalsWithin(_globals);
+				if (bad.has_value())
+					return DescribeUnsupported(fn, bad.value(), "assembly");
+			}
+
+			// 入口时 rsp 模 16 余 8，push rbp 之后对齐；保存寄存器和帧之后仍然对齐
+			auto name = fn < 0 ? std::string("c0_start") : "c0_F" + std::to_string(fn);
+			_out << name << ":\n";
+			ins("pushq %rbp");
+			ins("movq %rsp, %rbp");
+			for (int32_t k = 0; k < _saved; k++)
+				ins(std::string("pushq ") + kSavedRegs[k]);
+			if (frame > 0)
+				ins("subq $" + std::to_string(frame) + ", %rsp");
+			if (fn >= 0) {
+				auto np = _program.functions[fn].num_par;
+				for (int32_t k = 0; k < np; k++) {
+					if (k < kArgRegCount)
+						move(slot(k), kArgRegs[k]);
+					else
+						move(slot(k), std::to_string(16 + 8 * (k - kArgRegCount)) + "(%rbp)");
+				}
+			}
+
+			body(code, st);
+
+			_out << label(code.size() + 1) << ":\n";
+			ins("leaq -" + std::to_string(8 * _saved) + "(%rbp), %rsp");
+			for (auto k = _saved - 1; k >= 0; k--)
+				ins(std::string("popq ") + kSavedRegs[k]);
+			ins("popq %rbp");
+			ins("ret");
+			for (size_t t = 0; t < _traps.size(); t++) {
+				_out << label(code.size() + 2 + t) << ":\n";
+				ins("movl $" + std::to_string(fn) + ", %edi");
+				ins("movl $" + std::to_string(_traps[t].pc) + ", %esi");
+				ins(std::string("leaq c0_e_") + _traps[t].err + "(%rip), %rdx");
+				ins("jmp c0_trap");
+			}
+			return {};
+		}
+
+		void AsmEmitter::body(const std::vector<Instruction>& code, const StackAnalysis& st) {
+			auto n = code.size();
+			std::vector<char> target(n + 1, 0);
+			for (auto& i : code)
+				if (IsJump(i.GetOperation()))
+					target[i.GetX()] = 1;
+			auto ret = label(n + 1);
+
+			for (size_t i = 0; i <= n; i++) {
+				if (!st.Reachable(i))
+					continue;
+				if (target[i])
+					_out << label(i) << ":\n";
+				if (i == n) {
+					// .start 正常结束，函数不能越过最后一条指令
+					if (_fn >= 0)
+						trap("jmp", "VMBadJump", n);
+					break;
+				}
+
+				auto& in = code[i];
+				auto d = st.Depth(i);
+				auto x = in.GetX();
+				switch (in.GetOperation()) {
+				case Operation::nop:
+				case Operation::pop:
+				case Operation::loada:
+					break;
+				case Operation::bipush:
+					ins("movl $" + std::to_string(x & 0xff) + ", " + slot(d));
+					break;
+				case Operation::ipush:
+				case Operation::loadc:
+					// 常量池里只有函数名，loadc 压入的是下标
+					ins("movl $" + std::to_string(x) + ", " + slot(d));
+					break;
+				case Operation::iload:
+					move(slot(d - 1), var(st.Target(i)));
+					break;
+				case Operation::istore:
+					move(var(st.Target(i)), slot(d - 1));
+					break;
+				case Operation::iadd:
+				case Operation::isub:
+				case Operation::imul: {
+					auto opr = in.GetOperation();
+					ins("movl " + slot(d - 2) + ", %eax");
+					ins(std::string(opr == Operation::iadd ? "addl " : (opr == Operation::isub ? "subl " : "imull ")) + slot(d - 1) + ", %eax");
+					trap("jo", "VMIntegerOverflow", i);
+					ins("movl %eax, " + slot(d - 2));
+					break;
+				}
+				case Operation::idiv:
+					ins("movl " + slot(d - 1) + ", %ecx");
+					ins("testl %ecx, %ecx");
+					trap("jz", "VMDivideByZero", i);
+					ins("movl " + slot(d - 2) + ", %eax");
+					// INT_MIN / -1 溢出
+					ins("cmpl $-1, %ecx");
+					ins("jne 1f");
+					ins("cmpl $0x80000000, %eax");
+					trap("je", "VMIntegerOverflow", i);
+					_out << "1:\n";
+					ins("cltd");
+					ins("idivl %ecx");
+					ins("movl %eax, " + slot(d - 2));
+					break;
+				case Operation::ineg:
+					ins("movl " + slot(d - 1) + ", %eax");
+					ins("negl %eax");
+					trap("jo", "VMIntegerOverflow", i);
+					ins("movl %eax, " + slot(d - 1));
+					break;
+				case Operation::icmp:
+					ins("movl " + slot(d - 2) + ", %eax");
+					ins("cmpl " + slot(d - 1) + ", %eax");
+					// icmp + 条件跳转直接用比较的结果
+					if (i + 1 < n && isCondJump(code[i + 1].GetOperation()) && !target[i + 1]) {
+						auto& jcc = code[++i];
+						ins(std::string(jumpMnemonic(jcc.GetOperation())) + " " + label(jcc.GetX()));
+					}
+					else {
+						ins("setg %al");
+						ins("setl %cl");
+						ins("movzbl %al, %eax");
+						ins("movzbl %cl, %ecx");
+						ins("subl %ecx, %eax");
+						ins("movl %eax, " + slot(d - 2));
+					}
+					break;
+				case Operation::jmp:
+					ins("jmp " + label(x));
+					break;
+				case Operation::je:
+				case Operation::jne:
+				case Operation::jl:
+				case Operation::jge:
+				case Operation::jg:
+				case Operation::jle:
+					ins("cmpl $0, " + slot(d - 1));
+					ins(std::string(jumpMnemonic(in.GetOperation())) + " " + label(x));
+					break;
+				case Operation::call: {
+					auto& callee = _callees[x];
+					auto base = d - callee.num_par;
+					ins("cmpl $65536, c0_frames(%rip)");
+					trap("jae", "VMStackOverflow", i);
+					ins("incl c0_frames(%rip)");
+					// 第七个起的参数从右往左压栈，压完 rsp 仍然按 16 对齐
+					auto stacked = callee.num_par > kArgRegCount ? callee.num_par - kArgRegCount : 0;
+					auto pad = stacked % 2 != 0 ? 8 : 0;
+					// 压完参数、建好被调用者的帧之后不能越过机器栈的下限
+					ins("leaq -" + std::to_string(8 * stacked + pad + _frame_sizes[x]) + "(%rsp), %rax");
+					ins("cmpq c0_stack_limit(%rip), %rax");
+					trap("jb", "VMStackOverflow", i);
+					if (pad != 0)
+						ins("subq $8, %rsp");
+					for (auto k = callee.num_par - 1; k >= kArgRegCount; k--) {
+						ins("movl " + slot(base + k) + ", %eax");
+						ins("pushq %rax");
+					}
+					for (int32_t k = 0; k < callee.num_par && k < kArgRegCount; k++)
+						ins("movl " + slot(base + k) + ", " + kArgRegs[k]);
+					ins("call c0_F" + std::to_string(x));
+					if (stacked > 0)
+						ins("addq $" + std::to_string(8 * stacked + pad) + ", %rsp");
+					ins("decl c0_frames(%rip)");
+					if (callee.results > 0)
+						ins("movl %eax, " + slot(base));
+					break;
+				}
+				case Operation::ret:
+					ins("xorl %eax, %eax");
+					ins("jmp " + ret);
+					break;
+				case Operation::iret:
+					ins("movl " + slot(d - 1) + ", %eax");
+					ins("jmp " + ret);
+					break;
+				case Operation::iprint:
+				case Operation::cprint:
+					ins("movl " + slot(d - 1) + ", %edi");
+					ins(in.GetOperation() == Operation::iprint ? "call c0_iprint" : "call c0_putc");
+					break;
+				case Operation::printl:
+					ins("movl $10, %edi");
+					ins("call c0_putc");
+					break;
+				case Operation::iscan:
+					ins("movl $" + std::to_string(_fn) + ", %edi");
+					ins("movl $" + std::to_string(i) + ", %esi");
+					ins("call c0_iscan");
+					ins("movl %eax, " + slot(d));
+					break;
+				default:
+					// 栈分析已经拒绝了其余的操作码
+					break;
+				}
+			}
+		}
+
+		std::string AsmEmitter::slot(int32_t k) const {
+			if (_fn < 0)
+				return "c0_g+" + std::to_string(4 * k) + "(%rip)";
+			if (k < kRegSlots)
+				return kSlotRegs[k];
+			return "-" + std::to_string(8 * _saved + 4 * (k - kRegSlots + 1)) + "(%rbp)";
+		}
+
+		std::string AsmEmitter::var(const StackSlot& a) const {
+			if (a.global)
+				return "c0_g+" + std::to_string(4 * a.slot) + "(%rip)";
+			return slot(a.slot);
+		}
+
+		// 指令 i 的标签；n + 1 为返回，之后是陷入桩
+		std::string AsmEmitter::label(size_t i) const {
+			return ".L" + (_fn < 0 ? std::string("S") : std::to_string(_fn)) + "_" + std::to_string(i);
+		}
+
+		void AsmEmitter::move(const std::string& dst, const std::string& src) {
+			// 两边都是内存时经过 eax
+			if (dst[0] != '%' && src[0] != '%') {
+				ins("movl " + src + ", %eax");
+				ins("movl %eax, " + dst);
+			}
+			else if (dst != src)
+				ins("movl " + src + ", " + dst);
+		}
+
+		void AsmEmitter::trap(const char* jcc, const char* err, size_t pc) {
+			// 桩的标签在 function 里按同样的编号输出
+			auto n = _fn < 0 ? _program.start->size() : _program.functions[_fn].code->size();
+			ins(std::string(jcc) + " " + label(n + 2 + _traps.size()));
+			_traps.push_back(TrapSite{ err, (int32_t)pc });
+		}
+	}
+
+	std::optional<std::string> EmitAsm(const Program& program, std::ostream& out) {
+		return AsmEmitter(program, out).Emit();
+	}
+}
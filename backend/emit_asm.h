@@ -0,0 +1,19 @@
+#pragma once
+
+#include "backend/program.h"
+
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace miniplc0 {
+
+	// 把程序翻译成 x86-64 Linux 的 GNU as 汇编（AT&T 语法），入口为 _start，不依赖 libc：
+	//   as out.s -o out.o && ld out.o -o out
+	// 栈槽 0-4 放在 rbx、r12-r15，其余放在机器栈的帧里；函数按 System V 约定传参和返回。
+	// 输入输出和陷入由文件里附带的一小段运行时用系统调用完成，
+	// 运行时错误和 cc0-vm 一样在 stderr 输出 "Err at ..." 并以 3 退出。
+	// 调用深度超过 65536 帧，或者被调用者的帧会越过按 RLIMIT_STACK 定下的机器栈下限时报 VMStackOverflow。
+	// 指令流通不过栈分析时返回出错信息
+	std::optional<std::string> EmitAsm(const Program& program, std::ostream& out);
+}
@@ -0,0 +1,332 @@
+#include "backend/emit_c.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+
+namespace miniplc0 {
+
+	namespace {
+
+		// 生成的文件开头的运行时：带检查的算术、调用深度和输入输出，和 cc0-vm 的行为一致
+		const char* const kRuntime = R"(#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+static int32_t c0_frames;
+
+static _Noreturn void c0_trap(const char* err, int fn, int pc) {
+	fflush(stdout);
+	if (fn < 0)
+		fprintf(stderr, "Err at .start:%d:\t%s\n", pc, err);
+	else
+		fprintf(stderr, "Err at .F%d:%d:\t%s\n", fn, pc, err);
+	exit(3);
+}
+
+static inline int32_t c0_check(int64_t r, int fn, int pc) {
+	if (r < INT32_MIN || r > INT32_MAX)
+		c0_trap("VMIntegerOverflow", fn, pc);
+	return (int32_t)r;
+}
+
+static inline int32_t c0_add(int32_t a, int32_t b, int fn, int pc) { return c0_check((int64_t)a + b, fn, pc); }
+static inline int32_t c0_sub(int32_t a, int32_t b, int fn, int pc) { return c0_check((int64_t)a - b, fn, pc); }
+static inline int32_t c0_mul(int32_t a, int32_t b, int fn, int pc) { return c0_check((int64_t)a * b, fn, pc); }
+static inline int32_t c0_neg(int32_t a, int fn, int pc) { return c0_check(-(int64_t)a, fn, pc); }
+
+static inline int32_t c0_div(int32_t a, int32_t b, int fn, int pc) {
+	if (b == 0)
+		c0_trap("VMDivideByZero", fn, pc);
+	if (a == INT32_MIN && b == -1)
+		c0_trap("VMIntegerOverflow", fn, pc);
+	return a / b;
+}
+
+static inline void c0_enter(int fn, int pc) {
+	if (c0_frames >= 65536)
+		c0_trap("VMStackOverflow", fn, pc);
+	c0_frames++;
+}
+
+static inline void c0_iprint(int32_t v) { printf("%ld", (long)v); }
+
+static inline int32_t c0_iscan(int fn, int pc) {
+	long v;
+	if (scanf("%ld", &v) != 1 || v < INT32_MIN || v > INT32_MAX)
+		c0_trap("VMBadInput", fn, pc);
+	return (int32_t)v;
+}
+)";
+
+		bool isCondJump(Operation opr) {
+			return IsJump(opr) && opr != Operation::jmp;
+		}
+
+		// icmp 的结果与 0 比较，等价于直接比较两个操作数
+		const char* relation(Operation opr) {
+			switch (opr) {
+			case Operation::je: return "==";
+			case Operation::jne: return "!=";
+			case Operation::jl: return "<";
+			case Operation::jge: return ">=";
+			case Operation::jg: return ">";
+			default: return "<=";
+			}
+		}
+
+		class CEmitter final {
+		private:
+			using int32_t = std::int32_t;
+			using size_t = std::size_t;
+		public:
+			CEmitter(const Program& program, std::ostream& out)
+				: _program(program), _out(&out), _callees(GetCallTargets(program)), _globals(0), _fn(-1), _used() {}
+
+			std::optional<std::string> Emit();
+		private:
+			// 输出一个单元（fn 为 -1 时是 .start）的函数体
+			std::optional<std::string> body(int32_t fn, const std::vector<Instruction>& code, const StackAnalysis& st);
+			// 当前单元的第 k 个栈槽。.start 的帧就是全局变量
+			std::string slot(int32_t k);
+			std::string var(const StackSlot& a);
+			std::string where(int32_t fn, size_t pc) const;
+			void signature(int32_t fn);
+		private:
+			const Program& _program;
+			// 函数体先写进缓冲，知道用到了哪些栈槽之后再输出声明
+			std::ostream* _out;
+			std::vector<CallTarget> _callees;
+			int32_t _globals;
+			int32_t _fn;
+			std::vector<char> _used;
+		};
+
+		std::optional<std::string> CEmitter::Emit() {
+			auto& start = *_program.start;
+			StackAnalysis st;
+			auto bad = st.Run(start, 0, 0, _callees);
+			if (bad.has_value())
+				return where(-1, bad.value());
+			if (st.Reachable(start.size()))
+				_globals = st.Depth(start.size());
+
+			*_out << "/* generated by cc0 --emit-c */\n" << kRuntime << "\n";
+			*_out << "static int32_t c0_g[" << (st.MaxDepth() > 0 ? st.MaxDepth() : 1) << "];\n\n";
+			for (int32_t f = 0; f < (int32_t)_program.functions.size(); f++) {
+				signature(f);
+				*_out << ";\n";
+			}
+
+			*_out << "\nstatic void c0_start(void) {\n";
+			_fn = -1;
+			auto err = body(-1, start, st);
+			if (err.has_value())
+				return err;
+			*_out << "}\n";
+
+			for (int32_t f = 0; f < (int32_t)_program.functions.size(); f++) {
+				auto& func = _program.functions[f];
+				StackAnalysis fs;
+				bad = fs.Run(*func.code, func.num_par, func.level, _callees);
+				if (bad.has_value())
+					return where(f, bad.value());
+				auto out = _out;
+				std::ostringstream code;
+				_out = &code;
+				_fn = f;
+				_used.assign(fs.MaxDepth(), 0);
+				err = body(f, *func.code, fs);
+				_out = out;
+				if (err.has_value())
+					return err;
+				*_out << "\n/* " << func.name << " */\n";
+				signature(f);
+				*_out << " {\n";
+				const char* sep = "\tint32_t ";
+				for (auto k = func.num_par; k < fs.MaxDepth(); k++)
+					if (_used[k]) {
+						*_out << sep << "s" << k << " = 0";
+						sep = ", ";
+					}
+				if (sep[0] == ',')
+					*_out << ";\n";
+				*_out << code.str() << "}\n";
+			}
+
+			// 和 cc0-vm 一样先执行 .start，再找 main；main 的参数取自全局变量的末尾
+			*_out << "\nint main(void) {\n\t(void)c0_g;\n\tc0_frames = 1;\n\tc0_start();\n";
+			int32_t main = -1;
+			for (int32_t f = 0; f < (int32_t)_program.functions.size() && main < 0; f++)
+				if (_program.functions[f].name == "main")
+					main = f;
+			if (main < 0)
+				*_out << "\tc0_trap(\"VMNoMain\", -1, 0);\n";
+			else if (_program.functions[main].num_par > _globals)
+				*_out << "\tc0_trap(\"VMStackUnderflow\", " << main << ", 0);\n";
+			else {
+				auto np = _program.functions[main].num_par;
+				*_out << "\tc0_F" << main << "(";
+				for (int32_t k = 0; k < np; k++)
+					*_out << (k > 0 ? ", " : "") << "c0_g[" << _globals - np + k << "]";
+				*_out << ");\n\tfflush(stdout);\n\treturn 0;\n";
+			}
+			*_out << "}\n";
+			return {};
+		}
+
+		std::optional<std::string> CEmitter::body(int32_t fn, const std::vector<Instruction>& code, const StackAnalysis& st) {
+			// 全局变量只有 .start 留下的那些
+			if (fn >= 0) {
+				auto bad = st.GlobalsWithin(_globals);
+				if (bad.has_value())
+					return where(fn, bad.value());
+			}
+			auto n = code.size();
+			std::vector<char> target(n + 1, 0);
+			for (auto& ins : code)
+				if (IsJump(ins.GetOperation()))
+					target[ins.GetX()] = 1;
+
+			for (size_t i = 0; i <= n; i++) {
+				if (!st.Reachable(i))
+					continue;
+				if (target[i])
+					*_out << "L" << i << ":;\n";
+				if (i == n) {
+					// .start 正常结束，函数不能越过最后一条指令
+					if (fn >= 0)
+						*_out << "\tc0_trap(\"VMBadJump\", " << fn << ", " << n << ");\n";
+					break;
+				}
+
+				auto& ins = code[i];
+				auto d = st.Depth(i);
+				auto x = ins.GetX();
+				auto site = std::to_string(fn) + ", " + std::to_string(i);
+				switch (ins.GetOperation()) {
+				case Operation::nop:
+				case Operation::pop:
+				case Operation::loada:
+					break;
+				case Operation::bipush:
+					*_out << "\t" << slot(d) << " = " << (x & 0xff) << ";\n";
+					break;
+				case Operation::ipush:
+				case Operation::loadc:
+					// 常量池里只有函数名，loadc 压入的是下标
+					*_out << "\t" << slot(d) << " = " << x << ";\n";
+					break;
+				case Operation::iload:
+					*_out << "\t" << slot(d - 1) << " = " << var(st.Target(i)) << ";\n";
+					break;
+				case Operation::istore:
+					*_out << "\t" << var(st.Target(i)) << " = " << slot(d - 1) << ";\n";
+					break;
+				case Operation::iadd:
+				case Operation::isub:
+				case Operation::imul:
+				case Operation::idiv: {
+					auto opr = ins.GetOperation();
+					auto name = opr == Operation::iadd ? "c0_add" : (opr == Operation::isub ? "c0_sub" : (opr == Operation::imul ? "c0_mul" : "c0_div"));
+					*_out << "\t" << slot(d - 2) << " = " << name << "(" << slot(d - 2) << ", " << slot(d - 1) << ", " << site << ");\n";
+					break;
+				}
+				case Operation::ineg:
+					*_out << "\t" << slot(d - 1) << " = c0_neg(" << slot(d - 1) << ", " << site << ");\n";
+					break;
+				case Operation::icmp:
+					// icmp + 条件跳转直接写成比较
+					if (i + 1 < n && isCondJump(code[i + 1].GetOperation()) && !target[i + 1]) {
+						auto& jcc = code[++i];
+						*_out << "\tif (" << slot(d - 2) << " " << relation(jcc.GetOperation()) << " " << slot(d - 1)
+							<< ") goto L" << jcc.GetX() << ";\n";
+					}
+					else
+						*_out << "\t" << slot(d - 2) << " = (" << slot(d - 2) << " > " << slot(d - 1) << ") - ("
+							<< slot(d - 2) << " < " << slot(d - 1) << ");\n";
+					break;
+				case Operation::jmp:
+					*_out << "\tgoto L" << x << ";\n";
+					break;
+				case Operation::je:
+				case Operation::jne:
+				case Operation::jl:
+				case Operation::jge:
+				case Operation::jg:
+				case Operation::jle:
+					*_out << "\tif (" << slot(d - 1) << " " << relation(ins.GetOperation()) << " 0) goto L" << x << ";\n";
+					break;
+				case Operation::call: {
+					auto& callee = _callees[x];
+					auto base = d - callee.num_par;
+					*_out << "\tc0_enter(" << site << ");\n\t";
+					if (callee.results > 0)
+						*_out << slot(base) << " = ";
+					*_out << "c0_F" << x << "(";
+					for (auto k = base; k < d; k++)
+						*_out << (k > base ? ", " : "") << slot(k);
+					*_out << ");\n\tc0_frames--;\n";
+					break;
+				}
+				case Operation::ret:
+					*_out << (fn < 0 ? "\treturn;\n" : "\treturn 0;\n");
+					break;
+				case Operation::iret:
+					if (fn < 0)
+						*_out << "\treturn;\n";
+					else
+						*_out << "\treturn " << slot(d - 1) << ";\n";
+					break;
+				case Operation::iprint:
+					*_out << "\tc0_iprint(" << slot(d - 1) << ");\n";
+					break;
+				case Operation::cprint:
+					*_out << "\tputchar((unsigned char)" << slot(d - 1) << ");\n";
+					break;
+				case Operation::printl:
+					*_out << "\tputchar('\\n');\n";
+					break;
+				case Operation::iscan:
+					*_out << "\t" << slot(d) << " = c0_iscan(" << site << ");\n";
+					break;
+				default:
+					// 栈分析已经拒绝了其余的操作码
+					break;
+				}
+			}
+			return {};
+		}
+
+		std::string CEmitter::slot(int32_t k) {
+			if (_fn < 0)
+				return "c0_g[" + std::to_string(k) + "]";
+			_used[k] = 1;
+			return "s" + std::to_string(k);
+		}
+
+		std::string CEmitter::var(const StackSlot& a) {
+			if (a.global)
+				return "c0_g[" + std::to_string(a.slot) + "]";
+			return slot(a.slot);
+		}
+
+		std::string CEmitter::where(int32_t fn, size_t pc) const {
+			return DescribeUnsupported(fn, pc, "C");
+		}
+
+		void CEmitter::signature(int32_t fn) {
+			auto np = _program.functions[fn].num_par;
+			*_out << "static int32_t c0_F" << fn << "(";
+			if (np == 0)
+				*_out << "void";
+			for (int32_t k = 0; k < np; k++)
+				*_out << (k > 0 ? ", " : "") << "int32_t s" << k;
+			*_out << ")";
+		}
+	}
+
+	std::optional<std::string> EmitC(const Program& program, std::ostream& out) {
+		return CEmitter(program, out).Emit();
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "backend/program.h"
+
+#include <optional>
+#include <ostream>
+#include <string>
+
+namespace miniplc0 {
+
+	// 把程序翻译成一个独立的 C 文件（C99 + _Noreturn）：每个栈槽是一个局部变量，跳转是 goto，
+	// 全局变量是一个数组，.start 是 main 之前调用的初始化函数。
+	// 运行时错误和 cc0-vm 一样在 stderr 输出 "Err at ..." 并以 3 退出。
+	// 调用深度和 cc0-vm 一样限制在 65536 帧，但帧的大小由 C 编译器决定，局部变量多、递归深的程序
+	// 可能先耗尽机器栈：这种情况不会被陷入，进程直接因 SIGSEGV 结束（常见于 -O0）。
+	// 需要时用 ulimit -s 放大机器栈
+	// 指令流通不过栈分析时返回出错信息
+	std::optional<std::string> EmitC(const Program& program, std::ostream& out);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "instruction/instruction.h"
+#include "instruction/stack.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 后端的输入：分析完成的整个程序。指令仍然归 Analyser 所有
+	typedef struct {
+		std::string name;
+		std::int32_t num_par;
+		std::int32_t level;
+		const std::vector<Instruction>* code;
+	}ProgramFunction;
+
+	typedef struct {
+		const std::vector<Instruction>* start;
+		// 下标就是 call 的操作数
+		std::vector<ProgramFunction> functions;
+	}Program;
+
+	inline std::vector<CallTarget> GetCallTargets(const Program& program) {
+		std::vector<CallTarget> targets;
+		targets.reserve(program.functions.size());
+		for (auto& f : program.functions)
+			targets.push_back(GetCallTarget(f.num_par, *f.code));
+		return targets;
+	}
+
+	// 后端在 .F<fn>:<pc>（fn 为 -1 时是 .start）处无法静态确定操作数栈时的出错信息
+	inline std::string DescribeUnsupported(std::int32_t fn, std::size_t pc, const char* target) {
+		std::string unit = fn < 0 ? ".start" : ".F" + std::to_string(fn);
+		return "Cannot translate " + unit + ":" + std::to_string(pc) + " to " + target + ": the operand stack cannot be determined statically.";
+	}
+}
@@ -46,7 +46,8 @@ namespace miniplc0 {
 		ErrCompare,
 		ErrNoIF,
 		ErrNoWHILE,
-		ErrNoScan
+		ErrNoScan,
+		ErrArgCount
 	};
 
 	class CompilationError final {
@@ -71,6 +72,9 @@ namespace miniplc0 {
 			case ErrNoScan:
 				return "ErrNoScan";
 				break;
+			case ErrArgCount:
+				return "ErrArgCount";
+				break;
 			case ErrNoWHILE:
 				return "ErrNoWHILE";
 				break;
@@ -156,6 +160,7 @@ namespace miniplc0 {
 		ErrorCode GetCode() const { return _err; }
 
 		void print() {printf("Err at (%d,%d):\t%s\n",(int)_pos.first,(int)_pos.second,CtS(_err).c_str());}
+		void print(std::ostream& os) { os << "Err at (" << (int)_pos.first << "," << (int)_pos.second << "):\t" << CtS(_err) << "\n"; }
 
 	private:
 		std::pair<uint64_t, uint64_t> _pos;
@@ -95,8 +95,8 @@ namespace fmt {
 		template <typename FormatContext>
 		auto format(const miniplc0::Token &p, FormatContext &ctx) {
 			return format_to(ctx.out(),
-				"Line: {} Column: {} Type: {} Value: {}",
-				p.GetStartPos().first, p.GetStartPos().second, p.GetType(), p.GetValueString());
+				"Offset: {} Type: {} Value: {}",
+				p.GetStart(), p.GetType(), p.GetValue());
 		}
 	};
 
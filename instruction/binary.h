@@ -0,0 +1,155 @@
+#pragma once
+
+#include "instruction/instruction.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 在一块连续内存中拼出整个 o0 文件，多字节数据一律大端，最后一次性写出。
+	class BinaryWriter final {
+	private:
+		using uint8_t = std::uint8_t;
+		using uint16_t = std::uint16_t;
+		using uint32_t = std::uint32_t;
+	public:
+		explicit BinaryWriter(std::size_t reserve = 4096) : _buffer() { _buffer.reserve(reserve); }
+
+		void PutU8(uint8_t v) { _buffer.push_back(v); }
+		void PutU16(uint16_t v) {
+			uint8_t b[2] = { (uint8_t)(v >> 8), (uint8_t)v };
+			_buffer.insert(_buffer.end(), b, b + 2);
+		}
+		void PutU32(uint32_t v) {
+			uint8_t b[4] = { (uint8_t)(v >> 24), (uint8_t)(v >> 16), (uint8_t)(v >> 8), (uint8_t)v };
+			_buffer.insert(_buffer.end(), b, b + 4);
+		}
+		void PutBytes(std::string_view s) { _buffer.insert(_buffer.end(), s.begin(), s.end()); }
+
+		// 操作码 + 操作数
+		void PutInstruction(const Instruction& ins) {
+			auto opr = ins.GetOperation();
+			PutU8(GetOpcode(opr));
+			switch (opr) {
+			case Operation::bipush:
+				PutU8((uint8_t)ins.GetX());
+				break;
+			case Operation::ipush:
+				PutU32((uint32_t)ins.GetX());
+				break;
+			case Operation::loada:
+				PutU16((uint16_t)ins.GetX());
+				PutU32((uint32_t)ins.GetY());
+				break;
+			default:
+				if (GetOperandCount(opr) == 1)
+					PutU16((uint16_t)ins.GetX());
+				break;
+			}
+		}
+
+		const uint8_t* Data() const { return _buffer.data(); }
+		std::size_t Size() const { return _buffer.size(); }
+
+		// 整个缓冲区只做一次 write
+		void WriteTo(std::ostream& output) const {
+			output.write(reinterpret_cast<const char*>(_buffer.data()), (std::streamsize)_buffer.size());
+			output.flush();
+		}
+	private:
+		std::vector<uint8_t> _buffer;
+	};
+
+	// BinaryWriter 的逆过程：按大端读取，越界时返回 false 且不移动位置
+	class BinaryReader final {
+	private:
+		using uint8_t = std::uint8_t;
+		using uint16_t = std::uint16_t;
+		using uint32_t = std::uint32_t;
+	public:
+		BinaryReader(const uint8_t* data, std::size_t size) : _data(data), _size(size), _pos(0) {}
+
+		bool GetU8(uint8_t& v) {
+			if (_size - _pos < 1)
+				return false;
+			v = _data[_pos++];
+			return true;
+		}
+		bool GetU16(uint16_t& v) {
+			if (_size - _pos < 2)
+				return false;
+			v = (uint16_t)((_data[_pos] << 8) | _data[_pos + 1]);
+			_pos += 2;
+			return true;
+		}
+		bool GetU32(uint32_t& v) {
+			if (_size - _pos < 4)
+				return false;
+			v = ((uint32_t)_data[_pos] << 24) | ((uint32_t)_data[_pos + 1] << 16) | ((uint32_t)_data[_pos + 2] << 8) | (uint32_t)_data[_pos + 3];
+			_pos += 4;
+			return true;
+		}
+		bool GetBytes(std::size_t n, std::string_view& v) {
+			if (_size - _pos < n)
+				return false;
+			v = std::string_view(reinterpret_cast<const char*>(_data + _pos), n);
+			_pos += n;
+			return true;
+		}
+
+		// 读一条指令；操作码不认识或者操作数不完整时返回 false
+		bool GetInstruction(Instruction& ins) {
+			uint8_t op;
+			if (!GetU8(op))
+				return false;
+			auto opr = GetOperationByOpcode(op);
+			if (opr == Operation::ILL)
+				return false;
+			switch (opr) {
+			case Operation::bipush: {
+				uint8_t x;
+				if (!GetU8(x))
+					return false;
+				ins = Instruction(opr, x);
+				return true;
+			}
+			case Operation::ipush: {
+				uint32_t x;
+				if (!GetU32(x))
+					return false;
+				ins = Instruction(opr, (std::int32_t)x);
+				return true;
+			}
+			case Operation::loada: {
+				uint16_t x;
+				uint32_t y;
+				if (!GetU16(x) || !GetU32(y))
+					return false;
+				ins = Instruction(opr, x, (std::int32_t)y);
+				return true;
+			}
+			default:
+				if (GetOperandCount(opr) == 1) {
+					uint16_t x;
+					if (!GetU16(x))
+						return false;
+					ins = Instruction(opr, x);
+				}
+				else
+					ins = Instruction(opr);
+				return true;
+			}
+		}
+
+		std::size_t Position() const { return _pos; }
+		bool AtEnd() const { return _pos == _size; }
+	private:
+		const uint8_t* _data;
+		std::size_t _size;
+		std::size_t _pos;
+	};
+}
@@ -6,7 +6,7 @@
 namespace miniplc0 {
 
 
-	enum Operation {
+	enum Operation : std::uint8_t {
 		ILL = 0,
 		LIT,
 		LOD,
@@ -66,7 +66,9 @@ namespace miniplc0 {
 		iadd,
 		isub,
 		dadd,
-		dsub
+		dsub,
+		nop,
+		pop
 	};
 
 	class Instruction final {
@@ -75,25 +77,175 @@ namespace miniplc0 {
 	public:
 		friend void swap(Instruction& lhs, Instruction& rhs);
 	public:
-		Instruction(Operation opr, int32_t x) : _opr(opr), _x(x) {}
+		Instruction(Operation opr, int32_t x, int32_t y) : _opr(opr), _x(x), _y(y) {}
+		Instruction(Operation opr, int32_t x) : Instruction(opr, x, 0) {}
+		Instruction(Operation opr) : Instruction(opr, 0, 0) {}
 
 		Instruction() : Instruction(Operation::ILL, 0) {}
-		Instruction(const Instruction& i) { _opr = i._opr; _x = i._x; }
-		Instruction(Instruction&& i) :Instruction() { swap(*this, i); }
-		Instruction& operator=(Instruction i) { swap(*this, i); return *this; }
-		bool operator==(const Instruction& i) const { return _opr == i._opr && _x == i._x; }
+		Instruction(const Instruction& i) = default;
+		Instruction(Instruction&& i) = default;
+		Instruction& operator=(const Instruction& i) = default;
+		Instruction& operator=(Instruction&& i) = default;
+		bool operator==(const Instruction& i) const { return _opr == i._opr && _x == i._x && _y == i._y; }
 
 		Operation GetOperation() const { return _opr; }
 		int32_t GetX() const { return _x; }
+		int32_t GetY() const { return _y; }
 		void SetX(int x) { _x = x; }
+		void SetY(int y) { _y = y; }
 	private:
 		Operation _opr;
 		int32_t _x;
+		int32_t _y;
 	};
 
 	inline void swap(Instruction& lhs, Instruction& rhs) {
 		using std::swap;
 		swap(lhs._opr, rhs._opr);
 		swap(lhs._x, rhs._x);
+		swap(lhs._y, rhs._y);
 	}
-}
\ No newline at end of file
+
+	// 文本格式中的助记符
+	inline const char* GetOperationName(Operation opr) {
+		switch (opr) {
+		case nop: return "nop";
+		case bipush: return "bipush";
+		case ipush: return "ipush";
+		case pop: return "pop";
+		case loadc: return "loadc";
+		case loada: return "loada";
+		case iload: return "iload";
+		case istore: return "istore";
+		case iadd: return "iadd";
+		case isub: return "isub";
+		case imul: return "imul";
+		case idiv: return "idiv";
+		case ineg: return "ineg";
+		case icmp: return "icmp";
+		case jmp: return "jmp";
+		case je: return "je";
+		case jne: return "jne";
+		case jl: return "jl";
+		case jge: return "jge";
+		case jg: return "jg";
+		case jle: return "jle";
+		case call: return "call";
+		case ret: return "ret";
+		case iret: return "iret";
+		case iprint: return "iprint";
+		case cprint: return "cprint";
+		case printl: return "printl";
+		case iscan: return "iscan";
+		default: return "ill";
+		}
+	}
+
+	// o0 二进制格式中的操作码
+	inline std::uint8_t GetOpcode(Operation opr) {
+		switch (opr) {
+		case nop: return 0x00;
+		case bipush: return 0x01;
+		case ipush: return 0x02;
+		case pop: return 0x04;
+		case loadc: return 0x09;
+		case loada: return 0x0a;
+		case iload: return 0x10;
+		case istore: return 0x20;
+		case iadd: return 0x30;
+		case isub: return 0x34;
+		case imul: return 0x38;
+		case idiv: return 0x3c;
+		case ineg: return 0x40;
+		case icmp: return 0x44;
+		case jmp: return 0x70;
+		case je: return 0x71;
+		case jne: return 0x72;
+		case jl: return 0x73;
+		case jge: return 0x74;
+		case jg: return 0x75;
+		case jle: return 0x76;
+		case call: return 0x80;
+		case ret: return 0x88;
+		case iret: return 0x89;
+		case iprint: return 0xa0;
+		case cprint: return 0xa2;
+		case printl: return 0xaf;
+		case iscan: return 0xb0;
+		default: return 0xff;
+		}
+	}
+
+	// GetOpcode 的逆映射，不认识的操作码返回 ILL
+	inline Operation GetOperationByOpcode(std::uint8_t op) {
+		switch (op) {
+		case 0x00: return nop;
+		case 0x01: return bipush;
+		case 0x02: return ipush;
+		case 0x04: return pop;
+		case 0x09: return loadc;
+		case 0x0a: return loada;
+		case 0x10: return iload;
+		case 0x20: return istore;
+		case 0x30: return iadd;
+		case 0x34: return isub;
+		case 0x38: return imul;
+		case 0x3c: return idiv;
+		case 0x40: return ineg;
+		case 0x44: return icmp;
+		case 0x70: return jmp;
+		case 0x71: return je;
+		case 0x72: return jne;
+		case 0x73: return jl;
+		case 0x74: return jge;
+		case 0x75: return jg;
+		case 0x76: return jle;
+		case 0x80: return call;
+		case 0x88: return ret;
+		case 0x89: return iret;
+		case 0xa0: return iprint;
+		case 0xa2: return cprint;
+		case 0xaf: return printl;
+		case 0xb0: return iscan;
+		default: return ILL;
+		}
+	}
+
+	// 操作数个数：loada 两个，跳转、call、push 类一个，其余没有
+	inline int GetOperandCount(Operation opr) {
+		switch (opr) {
+		case loada:
+			return 2;
+		case bipush:
+		case ipush:
+		case loadc:
+		case jmp:
+		case je:
+		case jne:
+		case jl:
+		case jge:
+		case jg:
+		case jle:
+		case call:
+			return 1;
+		default:
+			return 0;
+		}
+	}
+
+	// 操作数是本指令流内指令下标的跳转：jmp 和六个条件跳转
+	inline bool IsJump(Operation opr) {
+		switch (opr) {
+		case jmp:
+		case je:
+		case jne:
+		case jl:
+		case jge:
+		case jg:
+		case jle:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
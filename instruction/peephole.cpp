@@ -0,0 +1,192 @@
+#include "instruction/peephole.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace miniplc0 {
+
+	namespace {
+
+		// 执行完不会落到下一条
+		bool endsFlow(Operation opr) {
+			return opr == Operation::jmp || opr == Operation::ret || opr == Operation::iret;
+		}
+
+		bool isPush(const Instruction& ins, std::int32_t v) {
+			return (ins.GetOperation() == Operation::ipush || ins.GetOperation() == Operation::bipush) && ins.GetX() == v;
+		}
+
+		typedef struct {
+			// 窗口长度
+			std::size_t length;
+			// w 为窗口，at 为窗口起点的下标。匹配时返回 true，替换后的指令（至多一条）写进 out，
+			// out 为空表示整个窗口都删掉
+			bool (*rewrite)(const Instruction* w, std::size_t at, std::vector<Instruction>& out);
+		}Rule;
+
+		const Rule kRules[] = {
+			// nop
+			{ 1, [](const Instruction* w, std::size_t, std::vector<Instruction>&) {
+				return w[0].GetOperation() == Operation::nop;
+			} },
+			// jmp 到下一条
+			{ 1, [](const Instruction* w, std::size_t at, std::vector<Instruction>&) {
+				return w[0].GetOperation() == Operation::jmp && (std::size_t)w[0].GetX() == at + 1;
+			} },
+			// 条件跳转到下一条：只剩下弹出比较结果
+			{ 1, [](const Instruction* w, std::size_t at, std::vector<Instruction>& out) {
+				if (!IsJump(w[0].GetOperation()) || w[0].GetOperation() == Operation::jmp || (std::size_t)w[0].GetX() != at + 1)
+					return false;
+				out.emplace_back(Operation::pop);
+				return true;
+			} },
+			// x + 0、x - 0
+			{ 2, [](const Instruction* w, std::size_t, std::vector<Instruction>&) {
+				return isPush(w[0], 0) && (w[1].GetOperation() == Operation::iadd || w[1].GetOperation() == Operation::isub);
+			} },
+			// x * 1、x / 1
+			{ 2, [](const Instruction* w, std::size_t, std::vector<Instruction>&) {
+				return isPush(w[0], 1) && (w[1].GetOperation() == Operation::imul || w[1].GetOperation() == Operation::idiv);
+			} },
+			// 一个字节放得下的立即数用 bipush（操作数是无符号的 u1）
+			{ 1, [](const Instruction* w, std::size_t, std::vector<Instruction>& out) {
+				if (w[0].GetOperation() != Operation::ipush || w[0].GetX() < 0 || w[0].GetX() > 0xff)
+					return false;
+				out.emplace_back(Operation::bipush, w[0].GetX());
+				return true;
+			} },
+		};
+
+		std::vector<char> jumpTargets(const std::vector<Instruction>& code) {
+			std::vector<char> target(code.size() + 1, 0);
+			for (auto& ins : code)
+				if (IsJump(ins.GetOperation()))
+					target[ins.GetX()] = 1;
+			return target;
+		}
+
+		// 只留下 keep 的指令，跳到被删指令的改为跳到它后面第一条留下的指令
+		void compact(std::vector<Instruction>& code, const std::vector<char>& keep) {
+			auto n = code.size();
+			std::vector<std::int32_t> index(n + 1);
+			std::int32_t k = 0;
+			for (std::size_t i = 0; i < n; i++) {
+				index[i] = k;
+				if (keep[i])
+					k++;
+			}
+			index[n] = k;
+			k = 0;
+			for (std::size_t i = 0; i < n; i++) {
+				if (!keep[i])
+					continue;
+				code[k] = code[i];
+				if (IsJump(code[k].GetOperation()))
+					code[k].SetX(index[code[k].GetX()]);
+				k++;
+			}
+			code.resize(k);
+		}
+
+		// 跳到 jmp 的改为直接跳到最终目标；无条件跳到 ret/iret 的直接返回
+		bool threadJumps(std::vector<Instruction>& code) {
+			bool changed = false;
+			auto n = code.size();
+			for (auto& ins : code) {
+				if (!IsJump(ins.GetOperation()))
+					continue;
+				auto t = ins.GetX();
+				std::size_t step = 0;
+				for (; step < n && code[t].GetOperation() == Operation::jmp; step++)
+					t = code[t].GetX();
+				// 只由 jmp 组成的死循环保持原样
+				if (step == n)
+					continue;
+				if (ins.GetOperation() == Operation::jmp && (code[t].GetOperation() == Operation::ret || code[t].GetOperation() == Operation::iret)) {
+					ins = Instruction(code[t].GetOperation());
+					changed = true;
+				}
+				else if (t != ins.GetX()) {
+					ins.SetX(t);
+					changed = true;
+				}
+			}
+			return changed;
+		}
+
+		bool removeUnreachable(std::vector<Instruction>& code) {
+			auto n = code.size();
+			if (n == 0)
+				return false;
+			std::vector<char> reached(n, 0);
+			std::vector<std::size_t> work{ 0 };
+			reached[0] = 1;
+			while (!work.empty()) {
+				auto i = work.back();
+				work.pop_back();
+				auto opr = code[i].GetOperation();
+				if (!endsFlow(opr) && i + 1 < n && !reached[i + 1]) {
+					reached[i + 1] = 1;
+					work.push_back(i + 1);
+				}
+				if (IsJump(opr) && !reached[code[i].GetX()]) {
+					reached[code[i].GetX()] = 1;
+					work.push_back(code[i].GetX());
+				}
+			}
+			for (auto r : reached)
+				if (!r) {
+					compact(code, reached);
+					return true;
+				}
+			return false;
+		}
+
+		bool applyRules(std::vector<Instruction>& code) {
+			auto n = code.size();
+			auto target = jumpTargets(code);
+			std::vector<char> keep(n, 1);
+			std::vector<Instruction> out;
+			bool changed = false;
+			for (std::size_t i = 0; i < n; i++) {
+				for (auto& rule : kRules) {
+					if (i + rule.length > n)
+						continue;
+					// 窗口中间被跳到时不能合并
+					bool inner = false;
+					for (std::size_t j = i + 1; j < i + rule.length; j++)
+						inner |= target[j] != 0;
+					if (inner)
+						continue;
+					out.clear();
+					if (!rule.rewrite(&code[i], i, out))
+						continue;
+					// 末尾被跳到的指令不能删光，否则跳转目标越界
+					if (out.empty() && target[i] && i + rule.length == n)
+						continue;
+					for (std::size_t j = i; j < i + rule.length; j++)
+						keep[j] = 0;
+					if (!out.empty()) {
+						code[i] = out[0];
+						keep[i] = 1;
+					}
+					i += rule.length - 1;
+					changed = true;
+					break;
+				}
+			}
+			if (changed)
+				compact(code, keep);
+			return changed;
+		}
+	}
+
+	void Peephole(std::vector<Instruction>& code) {
+		bool changed = true;
+		while (changed) {
+			changed = threadJumps(code);
+			changed |= removeUnreachable(code);
+			changed |= applyRules(code);
+		}
+	}
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "instruction/instruction.h"
+
+#include <vector>
+
+namespace miniplc0 {
+
+	// 窥孔优化：按规则表化简局部的指令序列，串联跳转链，删掉不可达的代码，
+	// 反复进行直到没有变化。就地修改，跳转的操作数是指令下标，删掉指令后会重新编号。
+	void Peephole(std::vector<Instruction>& code);
+}
@@ -0,0 +1,163 @@
+#include "instruction/stack.h"
+
+namespace miniplc0 {
+
+	std::optional<std::size_t> StackAnalysis::Run(const std::vector<Instruction>& code, int32_t num_par, int32_t level,
+		const std::vector<CallTarget>& callees) {
+		auto n = code.size();
+		_states.assign(n + 1, State{ -1, 0, 0 });
+		_addresses.clear();
+		_targets.assign(n, StackSlot{ false, false, 0 });
+		_max = num_par;
+
+		std::vector<size_t> work;
+		// 当前的栈深度和栈上的地址，地址按所在的深度从低到高排列
+		int32_t depth = num_par;
+		std::vector<LiveAddress> live;
+		// 把当前的栈带到第 i 条指令，已经到过时必须和上次一样
+		auto reach = [&](size_t i) {
+			auto& state = _states[i];
+			if (state.depth < 0) {
+				state.depth = depth;
+				state.first = (int32_t)_addresses.size();
+				state.count = (int32_t)live.size();
+				_addresses.insert(_addresses.end(), live.begin(), live.end());
+				work.push_back(i);
+				return true;
+			}
+			if (state.depth != depth || state.count != (int32_t)live.size())
+				return false;
+			for (int32_t k = 0; k < state.count; k++) {
+				auto& a = _addresses[state.first + k];
+				if (a.depth != live[k].depth || a.global != live[k].global || a.slot != live[k].slot)
+					return false;
+			}
+			return true;
+		};
+		// 弹出栈顶的 k 个值，其中不能有地址
+		auto popValues = [&](int32_t k) {
+			if (k < 0 || depth < k || (!live.empty() && live.back().depth >= depth - k))
+				return false;
+			depth -= k;
+			return true;
+		};
+		// 弹出一个地址，它指向的槽在弹出之后必须还在栈上
+		auto popAddress = [&](size_t i) {
+			if (depth == 0 || live.empty() || live.back().depth != depth - 1)
+				return false;
+			auto a = live.back();
+			live.pop_back();
+			depth--;
+			_targets[i] = StackSlot{ true, a.global, a.slot };
+			return a.slot >= 0 && (a.global || a.slot < depth);
+		};
+
+		reach(0);
+		while (!work.empty()) {
+			auto i = work.back();
+			work.pop_back();
+			if (i == n)
+				continue;
+			auto& state = _states[i];
+			depth = state.depth;
+			live.assign(_addresses.begin() + state.first, _addresses.begin() + state.first + state.count);
+			auto& ins = code[i];
+			bool ok = true, next = true, jump = false;
+			switch (ins.GetOperation()) {
+			case Operation::nop:
+			case Operation::printl:
+				break;
+			case Operation::bipush:
+			case Operation::ipush:
+			case Operation::loadc:
+			case Operation::iscan:
+				depth++;
+				break;
+			case Operation::pop:
+				ok = depth > 0;
+				if (ok && !live.empty() && live.back().depth == depth - 1)
+					live.pop_back();
+				if (ok)
+					depth--;
+				break;
+			case Operation::loada:
+				ok = ins.GetX() == 0 || ins.GetX() == level;
+				if (ok)
+					live.push_back(LiveAddress{ depth++, ins.GetX() != 0, ins.GetY() });
+				break;
+			case Operation::iload:
+				ok = popAddress(i);
+				depth++;
+				break;
+			case Operation::istore:
+				ok = popValues(1) && popAddress(i);
+				break;
+			case Operation::iadd:
+			case Operation::isub:
+			case Operation::imul:
+			case Operation::idiv:
+			case Operation::icmp:
+				ok = popValues(2);
+				depth++;
+				break;
+			case Operation::ineg:
+				ok = popValues(1);
+				depth++;
+				break;
+			case Operation::jmp:
+				next = false;
+				jump = true;
+				break;
+			case Operation::je:
+			case Operation::jne:
+			case Operation::jl:
+			case Operation::jge:
+			case Operation::jg:
+			case Operation::jle:
+				ok = popValues(1);
+				jump = true;
+				break;
+			case Operation::call: {
+				if (ins.GetX() < 0 || (size_t)ins.GetX() >= callees.size()) {
+					ok = false;
+					break;
+				}
+				auto& callee = callees[ins.GetX()];
+				ok = popValues(callee.num_par);
+				depth += callee.results;
+				break;
+			}
+			case Operation::ret:
+				next = false;
+				break;
+			case Operation::iret:
+				ok = popValues(1);
+				next = false;
+				break;
+			case Operation::iprint:
+			case Operation::cprint:
+				ok = popValues(1);
+				break;
+			default:
+				ok = false;
+				break;
+			}
+			if (!ok)
+				return i;
+			if (depth > _max)
+				_max = depth;
+			if (next && !reach(i + 1))
+				return i;
+			if (jump && (ins.GetX() < 0 || (size_t)ins.GetX() > n || !reach(ins.GetX())))
+				return i;
+		}
+		return {};
+	}
+
+	std::optional<std::size_t> StackAnalysis::GlobalsWithin(int32_t globals) const {
+		for (size_t i = 0; i < _targets.size(); i++)
+			if (Reachable(i) && _targets[i].address && _targets[i].global && _targets[i].slot >= globals)
+				return i;
+		return {};
+	}
+}
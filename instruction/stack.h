@@ -0,0 +1,79 @@
+#pragma once
+
+#include "instruction/instruction.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 操作数栈上的一个槽：普通的值，或者 loada 压入的地址
+	typedef struct {
+		bool address;
+		// 地址指向全局变量，否则指向当前帧
+		bool global;
+		std::int32_t slot;
+	}StackSlot;
+
+	// 被调用的函数：参数个数，返回后留在栈上的值的个数（ret 为 0，iret 为 1）
+	typedef struct {
+		std::int32_t num_par;
+		std::int32_t results;
+	}CallTarget;
+
+	// 指令流的静态栈分析：从帧里已有 num_par 个参数开始，沿所有路径推出每条指令执行前的栈。
+	// 要求汇合处的栈一致、不下溢，地址只被 iload/istore 用掉，且指向栈上已有的槽。
+	// 每条指令只记下栈深度和栈上尚未用掉的地址（通常没有），iload/istore 用到的地址另外记下。
+	// 下标 code.size() 表示越过最后一条指令。
+	class StackAnalysis final {
+	private:
+		using int32_t = std::int32_t;
+		using size_t = std::size_t;
+
+		// 栈上第 depth 个槽里的地址
+		typedef struct {
+			int32_t depth;
+			bool global;
+			int32_t slot;
+		}LiveAddress;
+
+		// 指令执行前的栈：深度为 -1 表示不可达，地址是 _addresses 中 [first, first + count) 这一段
+		typedef struct {
+			int32_t depth;
+			int32_t first;
+			int32_t count;
+		}State;
+	public:
+		StackAnalysis() : _states(), _addresses(), _targets(), _max(0) {}
+
+		// level 为函数的层次，loada 的层次差为 0 时指向当前帧，等于 level 时指向全局变量。
+		// 不满足要求时返回第一条出问题的指令的下标
+		std::optional<size_t> Run(const std::vector<Instruction>& code, int32_t num_par, int32_t level,
+			const std::vector<CallTarget>& callees);
+
+		bool Reachable(size_t i) const { return _states[i].depth >= 0; }
+		// 第 i 条指令执行前的栈深度
+		int32_t Depth(size_t i) const { return _states[i].depth; }
+		// 第 i 条 iload/istore 用掉的地址，其余指令处 address 为 false
+		const StackSlot& Target(size_t i) const { return _targets[i]; }
+		// 包括参数在内的最大深度
+		int32_t MaxDepth() const { return _max; }
+		// 可达的 iload/istore 用到的全局变量都在前 globals 个槽里时返回空，否则返回第一条越界的指令的下标
+		std::optional<size_t> GlobalsWithin(int32_t globals) const;
+	private:
+		std::vector<State> _states;
+		std::vector<LiveAddress> _addresses;
+		std::vector<StackSlot> _targets;
+		int32_t _max;
+	};
+
+	// 作为调用目标的函数：有 iret 的函数返回一个值
+	inline CallTarget GetCallTarget(std::int32_t num_par, const std::vector<Instruction>& code) {
+		for (auto& ins : code)
+			if (ins.GetOperation() == Operation::iret)
+				return CallTarget{ num_par, 1 };
+		return CallTarget{ num_par, 0 };
+	}
+}
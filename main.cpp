@@ -1,126 +1,242 @@
 #include "argparse.hpp"
 #include "fmt/core.h"
 #include "tokenizer/tokenizer.h"
+#include "tokenizer/source.h"
 #include "analyser/analyser.h"
+#include "backend/emit_c.h"
+#include "backend/emit_asm.h"
+#include "parallel/thread_pool.h"
+#include "arena/arena.h"
 #include "instruction/instruction.h"
 #include "error/error.h"
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <filesystem>
+#include <sstream>
+#include <string>
+#include <vector>
 using namespace miniplc0;
 
-	std::vector<miniplc0::Token> _tokenize(std::istream& input) {
-		miniplc0::Tokenizer tkz(input);
-		auto p = tkz.AllTokens();
-		if (p.second.has_value()) {
-			//fmt::print(stderr, "Tokenization error: {}\n", p.second.value());
-			
-			exit(2);
-		}
-		return p.first;
-	}
+	// һļõפ arenaʱÿ߳һݣļ֮临
+	struct Workspace {
+		StringInterner interner;
+		Arena arena;
+	};
 
-	void CA(std::istream& input, std::ostream& output) {
+	// ʽ-c-s--emit-c--emit-asm
+	enum OutputMode {
+		MODE_BINARY,
+		MODE_TEXT,
+		MODE_C,
+		MODE_ASM
+	};
+
+	// ¼ؽ̵˳룬Ϣд diag
+	int CA(const SourceBuffer& input, std::ostream& output, Workspace& ws, ThreadPool* pool, std::ostream&) {
 		
-		auto vc = _tokenize(input);
-		miniplc0::Analyser analyser(vc);
+		miniplc0::Tokenizer tkz(input, ws.interner);
+		miniplc0::Analyser analyser(tkz, pool, &ws.arena);
 		auto err = analyser.Analyse();
+		if (analyser._lex_error.has_value())
+			return 2;
 		if (err.second.has_value()) {
 			//printf("sth wrong with analyser");
-			exit(0);
+			return 0;
 		}
 
 		analyser.printBinary(output);
-		return;
+		return 0;
 	}
 
-	void SA(std::istream& input, std::ostream& output) {
+	void printInstructions(const std::vector<Instruction>& ins, std::ostream& output) {
+		for (std::size_t i = 0; i < ins.size(); i++) {
+			auto opr = ins[i].GetOperation();
+			output << i << "\t" << GetOperationName(opr);
+			if (GetOperandCount(opr) >= 1)
+				output << "\t" << ins[i].GetX();
+			if (GetOperandCount(opr) >= 2)
+				output << "," << ins[i].GetY();
+			output << "\n";
+		}
+	}
 
-		auto vc = _tokenize(input);
+	int SA(const SourceBuffer& input, std::ostream& output, Workspace& ws, ThreadPool* pool, std::ostream& diag) {
 
-		miniplc0::Analyser analyser(vc);
+		auto& interner = ws.interner;
+		miniplc0::Tokenizer tkz(input, interner);
+		miniplc0::Analyser analyser(tkz, pool, &ws.arena);
 
 		auto err = analyser.Analyse();
+		if (analyser._lex_error.has_value())
+			return 2;
 		if (err.second.has_value()) {
 			auto er = err.second.value();
-			er.print();
-			exit(2);
+			er.print(diag);
+			return 2;
 		}
 
 
 		output << ".constants:\n";
 		
-		int ct = analyser._consts.size();
-		int ci = 0;
-		while (ci < ct) {
-			auto citer = analyser._consts.begin();
-			while (citer != analyser._consts.end()) {
-				if (citer->second->index == ci)
-					output << citer->second->index << "\t" << char(citer->second->type) << "\t\"" << citer->first << "\"\n";
-				citer++;
-			}
-			ci++;
-		}
+		for (auto c : analyser._constList)
+			output << c->index << "\t" << char(c->type) << "\t\"" << interner.Lookup(c->name) << "\"\n";
 
 		output << ".start:\n";
+		printInstructions(analyser._Sins, output);
 		
-		auto siter = analyser.Sins.begin();
-		int t = analyser.Sins.size();
-		int i = 0;
-		while (i < t) {
-			output << i << "\t" << analyser.Sins.at(i)->_opr;
-			if(!analyser.Sins.at(i)->_x.empty())
-				output<< "\t" << analyser.Sins.at(i)->_x ;
-			if (!analyser.Sins.at(i)->_y.empty())
-				output << "," << analyser.Sins.at(i)->_y;
-			siter++;
-			i++;
+		output << ".functions:\n";
+		for (auto f : analyser._funcList)
+			output << f->index << "\t" << f->name_index << "\t" << f->num_par << "\t" << f->level << "\t" << f->max_stack << "\t" << f->num_local << "\n";
 
-			output << "\n";
+		for (auto f : analyser._funcList) {
+			output << '.' << 'F' << f->index << ":\n";
+			printInstructions(analyser._Ains[f->index], output);
 		}
-		
-		output << ".functions:\n";
-		ct = analyser._funcs.size();
-		ci = 0;
-		while (ci < ct) {
-			auto fiter = analyser._funcs.begin();
-			while (fiter != analyser._funcs.end()) {
-				if(fiter->second->index == ci)
-				output << fiter->second->index << "\t" << fiter->second->name_index << "\t" << fiter->second->num_par << "\t" << fiter->second->level << "\n";
-				fiter++;
-			}
-			ci++;
-		}
-
-		ci = 0;
-		while (ci < ct) {
-			auto xeonblade = analyser._funcs.begin();
-			while (xeonblade != analyser._funcs.end()) {
-				if (ci == xeonblade->second->index) {
-					std::string ss = xeonblade->first;
-					output << '.' << 'F' << ci << ":\n";
-					std::vector<Opr*> xbld = analyser.Ains[ss];
-					auto itx = xbld.begin();
-					int j = 0;
-					while (itx != xbld.end()) {
-
-						output << j << "\t" << analyser.Ains[ss].at(j)->_opr;
-						if (!analyser.Ains[ss].at(j)->_x.empty()) {
-
-							output << "\t" << analyser.Ains[ss].at(j)->_x.c_str();
-						}
-						if (!analyser.Ains[ss].at(j)->_y.empty()) {
-							output << "," << analyser.Ains[ss].at(j)->_y;
-						}
-						itx++;
-						j++;
-						output << "\n";
-					}
+		return 0;
+	}
+
+	// Ҫĺָ
+	Program program(const Analyser& analyser, const StringInterner& interner) {
+		Program p{ &analyser._Sins, {} };
+		for (auto f : analyser._funcList)
+			p.functions.push_back(ProgramFunction{ std::string(interner.Lookup(f->name)), f->num_par, f->level, &analyser._Ains[f->index] });
+		return p;
+	}
+
+	// ֮󽻸 emitter  C ߻
+	int CE(const SourceBuffer& input, std::ostream& output, Workspace& ws, ThreadPool* pool, std::ostream& diag,
+		std::optional<std::string> (*emitter)(const Program&, std::ostream&)) {
+		miniplc0::Tokenizer tkz(input, ws.interner);
+		miniplc0::Analyser analyser(tkz, pool, &ws.arena);
+		auto err = analyser.Analyse();
+		if (analyser._lex_error.has_value())
+			return 2;
+		if (err.second.has_value()) {
+			err.second.value().print(diag);
+			return 2;
+		}
+		auto bad = emitter(program(analyser, ws.interner), output);
+		if (bad.has_value()) {
+			diag << bad.value() << "\n";
+			return 2;
+		}
+		return 0;
+	}
+
+	int emit(OutputMode mode, const SourceBuffer& input, std::ostream& output, Workspace& ws, ThreadPool* pool, std::ostream& diag) {
+		switch (mode) {
+		case MODE_BINARY: return CA(input, output, ws, pool, diag);
+		case MODE_TEXT: return SA(input, output, ws, pool, diag);
+		case MODE_C: return CE(input, output, ws, pool, diag, EmitC);
+		default: return CE(input, output, ws, pool, diag, EmitAsm);
+		}
+	}
+
+	// չ @Ӧļհ׷ָļŲѡ֮󣬽 argparse  remaining 
+	std::vector<std::string> normalizeArgs(int argc, char** argv) {
+		std::vector<std::string> args;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			if (arg.size() > 1 && arg[0] == '@') {
+				std::ifstream rsp(arg.substr(1));
+				if (!rsp) {
+					std::cerr << "Fail to open " << arg.substr(1) << " for reading.\n";
+					exit(2);
 				}
-				xeonblade++;
+				std::string word;
+				while (rsp >> word)
+					args.push_back(word);
+			}
+			else
+				args.push_back(arg);
+		}
+
+		std::vector<std::string> options{ argv[0] }, inputs;
+		for (std::size_t i = 0; i < args.size(); i++) {
+			auto& arg = args[i];
+			if (arg == "-o" || arg == "--output" || arg == "-j" || arg == "--jobs") {
+				options.push_back(arg);
+				if (i + 1 < args.size())
+					options.push_back(args[++i]);
+			}
+			// argparse ֻ -j 4 -j4  --jobs=4 
+			else if (arg.size() > 2 && arg.compare(0, 2, "-j") == 0) {
+				options.push_back("-j");
+				options.push_back(arg.substr(2));
 			}
-			ci++;
+			else if (arg.compare(0, 7, "--jobs=") == 0) {
+				options.push_back("--jobs");
+				options.push_back(arg.substr(7));
+			}
+			else if (arg.size() > 1 && arg[0] == '-')
+				options.push_back(arg);
+			else
+				inputs.push_back(arg);
 		}
-		return;
+		options.insert(options.end(), inputs.begin(), inputs.end());
+		return options;
+	}
+
+	// 룺ÿ outdir ͬ .o0.s.c  .asm jobs ļͬʱ롣
+	// Ϣ˳ظļ˳һ
+	int batch(const std::vector<std::string>& inputs, const std::string& outdir, OutputMode mode, int jobs) {
+		std::error_code ec;
+		std::filesystem::create_directories(outdir, ec);
+		if (!std::filesystem::is_directory(outdir)) {
+			std::cerr << "Fail to create directory " << outdir << ".\n";
+			return 2;
+		}
+
+		// ֻȡļͬĿ¼µͬдͬһļʱһҲ
+		auto n = inputs.size();
+		static const char* const extensions[] = { ".o0", ".s", ".c", ".asm" };
+		std::vector<std::filesystem::path> paths(n);
+		std::map<std::filesystem::path, std::size_t> owner;
+		for (std::size_t i = 0; i < n; i++) {
+			paths[i] = std::filesystem::path(outdir) / std::filesystem::path(inputs[i]).filename();
+			paths[i].replace_extension(extensions[mode]);
+			auto it = owner.emplace(paths[i].lexically_normal(), i);
+			if (!it.second) {
+				std::cout << inputs[i] << ": " << paths[i].string() << " is also the output of " << inputs[it.first->second] << ".\n";
+				return 2;
+			}
+		}
+
+		std::vector<int> status(n, 0);
+		std::vector<std::string> diags(n);
+		ThreadPool pool(jobs > 1 ? jobs : 1);
+		pool.ParallelFor(n, [&](std::size_t i) {
+			thread_local Workspace ws;
+			std::ostringstream diag;
+			SourceBuffer input;
+			if (inputs[i] == "-" || !input.Open(inputs[i])) {
+				diags[i] = "Fail to open for reading.\n";
+				status[i] = 2;
+				return;
+			}
+			auto& path = paths[i];
+			std::ofstream outf(path, mode == MODE_BINARY ? std::ios::out | std::ios::binary : std::ios::out | std::ios::trunc);
+			if (!outf) {
+				diags[i] = "Fail to open " + path.string() + " for writing.\n";
+				status[i] = 2;
+				return;
+			}
+			status[i] = emit(mode, input, outf, ws, nullptr, diag);
+			diags[i] = diag.str();
+			// ļķű﷨Ѿ Analyser arena Ŀһļ
+			ws.arena.Reset();
+		});
+
+		int ret = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			if (!diags[i].empty())
+				std::cout << inputs[i] << ": " << diags[i];
+			if (status[i] > ret)
+				ret = status[i];
+		}
+		return ret;
 	}
 	int main(int argc, char** argv) {
 		argparse::ArgumentParser program("cc0");
@@ -132,88 +248,83 @@ using namespace miniplc0;
 			.default_value(false)
 			.implicit_value(true)
 			.help(" c0 Դ뷭Ϊıļ");
+		program.add_argument("--emit-c")
+			.default_value(false)
+			.implicit_value(true)
+			.help(" c0 Դ뷭Ϊ C Դļ");
+		program.add_argument("--emit-asm")
+			.default_value(false)
+			.implicit_value(true)
+			.help(" c0 Դ뷭Ϊ x86-64 GNU ļ");
 		program.add_argument("input")
+			.remaining()
 			.help("kick your asshole.");
 		program.add_argument("-o", "--output")
 			.required()
 			.default_value(std::string("-"))
 			.help("ָļ file");
+		program.add_argument("-j", "--jobs")
+			.default_value(1)
+			.action([](const std::string& value) { return std::stoi(value); })
+			.help("е߳ļʱɸļʱͬʱļ");
 
 
+		std::vector<std::string> inputs;
 		try {
-			program.parse_args(argc, argv);
+			program.parse_args(normalizeArgs(argc, argv));
+			inputs = program.get<std::vector<std::string>>("input");
 		}
-		catch (const std::runtime_error & err) {
+		catch (const std::exception & err) {
+			// ԣûиļlogic_error
 			program.print_help();
 			exit(2);
 		}
 
-		auto input_file = program.get<std::string>("input");
 		auto output_file = program.get<std::string>("--output");
-		std::istream* input;
+		auto jobs = program.get<int>("--jobs");
+		int modes = (program["-c"] == true) + (program["-s"] == true) + (program["--emit-c"] == true)
+			+ (program["--emit-asm"] == true);
+		if (modes > 1) {
+			//fmt::print(stderr, "You can only perform tokenization or syntactic analysis at one time.");
+			exit(2);
+		}
+		if (modes == 0) {
+			//fmt::print(stderr, "You must choose tokenization or syntactic analysis.");
+			exit(2);
+		}
+		auto mode = program["-c"] == true ? MODE_BINARY : (program["-s"] == true ? MODE_TEXT
+			: (program["--emit-c"] == true ? MODE_C : MODE_ASM));
+		// 룬Ŀ¼ / βѾڣʱģʽ
+		if (inputs.size() > 1 || (output_file != "-" && (output_file.back() == '/' || std::filesystem::is_directory(output_file))))
+			return batch(inputs, output_file == "-" ? "." : output_file, mode, jobs);
+
+		auto input_file = inputs[0];
+		SourceBuffer input;
 		std::ostream* output;
-		std::ifstream inf;
 		std::ofstream outf;
 		if (input_file != "-") {
-			inf.open(input_file, std::ios::in);
-			if (!inf) {
+			if (!input.Open(input_file)) {
 				//fmt::print(stderr, "Fail to open {} for reading.\n", input_file);
 				exit(2);
 			}
-			input = &inf;
 		}
 		else
-			input = &std::cin;
-		if (output_file != "-") {
-			if (program["-c"] == true) {
-				outf.open(output_file, std::ios::out | std::ios::binary);
-				if (!outf) {
-					//fmt::print(stderr, "Fail to open {} for writing.\n", output_file);
-					exit(2);
-				}
-				output = &outf;
-			}
-			if (program["-s"] == true) {
-				outf.open(output_file, std::ios::out | std::ios::trunc);
-				if (!outf) {
-					//fmt::print(stderr, "Fail to open {} for writing.\n", output_file);
-					exit(2);
-				}
-				output = &outf;
-			}
-		}
-		else {
-			if (program["-c"] == true) {
-				outf.open("out", std::ios::out | std::ios::binary);
-				if (!outf) {
-					//fmt::print(stderr, "Fail to open {} for writing.\n", output_file);
-					exit(2);
-				}
-				output = &outf;
-			}
-			if (program["-s"] == true) {
-				outf.open("out", std::ios::out | std::ios::trunc);
-				if (!outf) {
-					//fmt::print(stderr, "Fail to open {} for writing.\n", output_file);
-					exit(2);
-				}
-				output = &outf;
-			}
-		}
-		//output = &std::cout;
-		if (program["-c"] == true && program["-s"] == true) {
-			//fmt::print(stderr, "You can only perform tokenization or syntactic analysis at one time.");
-			exit(2);
-		}
-		if (program["-c"] == true) {
-			CA(*input, *output);
-		}
-		else if (program["-s"] == true) {
-			SA(*input, *output);
-		}
-		else {
-			//fmt::print(stderr, "You must choose tokenization or syntactic analysis.");
+			input.Read(std::cin);
+		// ûи -o ʱд out
+		outf.open(output_file != "-" ? output_file : "out", mode == MODE_BINARY ? std::ios::out | std::ios::binary : std::ios::out | std::ios::trunc);
+		if (!outf) {
+			//fmt::print(stderr, "Fail to open {} for writing.\n", output_file);
 			exit(2);
 		}
+		output = &outf;
+		//output = &std::cout;
+		// Ĵɷָ̳߳
+		std::unique_ptr<ThreadPool> pool;
+		if (jobs > 1)
+			pool = std::make_unique<ThreadPool>(jobs);
+		Workspace ws;
+		auto status = emit(mode, input, *output, ws, pool.get(), std::cout);
+		if (status != 0)
+			exit(status);
 		return 0;
 	}
@@ -0,0 +1,72 @@
+#include "parallel/thread_pool.h"
+
+namespace miniplc0 {
+
+	ThreadPool::ThreadPool(size_t threads) : _queues(), _threads(), _next(0), _pending(0), _lock(), _wake(), _stop(false) {
+		auto workers = threads > 1 ? threads - 1 : 0;
+		// 没有工作线程时也留一个队列给调用线程
+		for (size_t i = 0; i < std::max<size_t>(workers, 1); i++)
+			_queues.push_back(std::make_unique<Queue>());
+		for (size_t i = 0; i < workers; i++)
+			_threads.emplace_back(&ThreadPool::worker, this, i);
+	}
+
+	ThreadPool::~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lk(_lock);
+			_stop = true;
+		}
+		_wake.notify_all();
+		for (auto& t : _threads)
+			t.join();
+	}
+
+	void ThreadPool::Submit(Task task) {
+		auto& q = *_queues[_next.fetch_add(1, std::memory_order_relaxed) % _queues.size()];
+		{
+			std::lock_guard<std::mutex> lk(q.lock);
+			q.tasks.push_back(std::move(task));
+		}
+		{
+			// 在 _lock 下增加计数，等待中的线程不会错过唤醒
+			std::lock_guard<std::mutex> lk(_lock);
+			_pending.fetch_add(1, std::memory_order_relaxed);
+		}
+		_wake.notify_one();
+	}
+
+	bool ThreadPool::steal(size_t self, Task& task) {
+		auto n = _queues.size();
+		for (size_t k = 0; k < n; k++) {
+			auto& q = *_queues[(self + k) % n];
+			std::lock_guard<std::mutex> lk(q.lock);
+			if (q.tasks.empty())
+				continue;
+			if (k == 0) {
+				task = std::move(q.tasks.front());
+				q.tasks.pop_front();
+			}
+			else {
+				task = std::move(q.tasks.back());
+				q.tasks.pop_back();
+			}
+			_pending.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+		return false;
+	}
+
+	void ThreadPool::worker(size_t self) {
+		Task task;
+		while (true) {
+			if (steal(self, task)) {
+				task();
+				continue;
+			}
+			std::unique_lock<std::mutex> lk(_lock);
+			_wake.wait(lk, [this]() { return _stop || _pending.load(std::memory_order_relaxed) != 0; });
+			if (_stop && _pending.load(std::memory_order_relaxed) == 0)
+				return;
+		}
+	}
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 工作窃取线程池：每个工作线程有自己的任务队列，从队头取任务，
+	// 自己的队列空了就从别的队列的队尾偷。等待一批任务的线程也参与执行。
+	class ThreadPool final {
+	private:
+		using size_t = std::size_t;
+		using Task = std::function<void()>;
+
+		struct Queue {
+			std::mutex lock;
+			std::deque<Task> tasks;
+		};
+	public:
+		// threads 为参与计算的线程总数（含调用线程），为 1 时所有任务都在调用线程上执行
+		explicit ThreadPool(size_t threads);
+		ThreadPool(ThreadPool&&) = delete;
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(ThreadPool) = delete;
+		// 执行完已经提交的任务后退出
+		~ThreadPool();
+
+		size_t Size() const { return _threads.size() + 1; }
+
+		// 按轮转放进某个工作线程的队列
+		void Submit(Task task);
+
+		// 对 [0, n) 的每个 i 调用 f(i)，全部完成后返回。f 必须可以并发调用
+		template<typename F>
+		void ParallelFor(size_t n, F f) {
+			if (n == 0)
+				return;
+			// 每个线程分到若干块，块太少时偷不到活，太多时调度开销变大
+			auto chunks = std::min(n, Size() * 8);
+			std::atomic<size_t> left(chunks);
+			for (size_t c = 0; c < chunks; c++) {
+				auto begin = n * c / chunks, end = n * (c + 1) / chunks;
+				Submit([&f, &left, begin, end]() {
+					for (auto i = begin; i < end; i++)
+						f(i);
+					left.fetch_sub(1, std::memory_order_release);
+				});
+			}
+			Task task;
+			while (left.load(std::memory_order_acquire) != 0) {
+				if (steal(0, task))
+					task();
+				else
+					std::this_thread::yield();
+			}
+		}
+	private:
+		void worker(size_t self);
+		// 先取 _queues[self] 的队头，再从其他队列的队尾偷
+		bool steal(size_t self, Task& task);
+	private:
+		std::vector<std::unique_ptr<Queue>> _queues;
+		std::vector<std::thread> _threads;
+		std::atomic<size_t> _next;
+		// 所有队列中尚未被取走的任务数
+		std::atomic<size_t> _pending;
+		std::mutex _lock;
+		std::condition_variable _wake;
+		bool _stop;
+	};
+}
@@ -0,0 +1,69 @@
+# cc0 批量模式的端到端测试：cmake -DCC0=<cc0 路径> -DWORK=<临时目录> -P batch.cmake
+
+function(expect_file path)
+	if(NOT EXISTS "${path}")
+		message(FATAL_ERROR "${path} was not written")
+	endif()
+endfunction()
+
+function(expect_same a b)
+	execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files "${a}" "${b}" RESULT_VARIABLE differ)
+	if(differ)
+		message(FATAL_ERROR "${a} differs from ${b}")
+	endif()
+endfunction()
+
+# 运行 cc0，要求退出码为 status，输出里含有 pattern
+function(run_cc0 status pattern)
+	execute_process(COMMAND "${CC0}" ${ARGN} WORKING_DIRECTORY "${WORK}"
+		RESULT_VARIABLE result OUTPUT_VARIABLE out ERROR_VARIABLE err)
+	if(NOT result EQUAL status)
+		message(FATAL_ERROR "cc0 ${ARGN}: exit ${result}, expected ${status}\n${out}${err}")
+	endif()
+	if(pattern AND NOT "${out}${err}" MATCHES "${pattern}")
+		message(FATAL_ERROR "cc0 ${ARGN}: output does not match '${pattern}'\n${out}${err}")
+	endif()
+endfunction()
+
+file(REMOVE_RECURSE "${WORK}")
+file(MAKE_DIRECTORY "${WORK}/src/sub")
+file(WRITE "${WORK}/src/a.c0" "int main() { print(1); return 0; }\n")
+file(WRITE "${WORK}/src/sub/b.c0" "int f(int x) { return x * 2; }\nint main() { print(f(21)); return 0; }\n")
+file(WRITE "${WORK}/src/sub/a.c0" "int main() { print(2); return 0; }\n")
+file(WRITE "${WORK}/src/bad.c0" "int main() { return }\n")
+
+# 单文件编译的结果作为参照
+run_cc0(0 "" -c src/a.c0 -o a.o0)
+run_cc0(0 "" -c src/sub/b.c0 -o b.o0)
+
+# 响应文件里的选项和输入用空白分隔，-jN 写在一起
+file(WRITE "${WORK}/args.rsp" "-c -j2\n  src/a.c0\tsrc/sub/b.c0\n-o out/\n")
+run_cc0(0 "" @args.rsp)
+expect_same("${WORK}/out/a.o0" "${WORK}/a.o0")
+expect_same("${WORK}/out/b.o0" "${WORK}/b.o0")
+
+# 输出名只取输入的文件名，扩展名跟着输出格式走
+foreach(pair "-s;s" "--emit-c;c" "--emit-asm;asm")
+	list(GET pair 0 flag)
+	list(GET pair 1 ext)
+	run_cc0(0 "" ${flag} --jobs=4 src/a.c0 src/sub/b.c0 -o out-${ext})
+	expect_file("${WORK}/out-${ext}/a.${ext}")
+	expect_file("${WORK}/out-${ext}/b.${ext}")
+endforeach()
+
+# 已经存在的目录即使只有一个输入也按批量处理
+run_cc0(0 "" -c src/sub/b.c0 -o out)
+expect_same("${WORK}/out/b.o0" "${WORK}/b.o0")
+
+# 两个输入写同一个输出时一个也不编译
+run_cc0(2 "out-dup.a\\.o0 is also the output of src/a\\.c0" -c -j2 src/a.c0 src/sub/a.c0 -o out-dup)
+if(EXISTS "${WORK}/out-dup/a.o0")
+	message(FATAL_ERROR "a duplicated output was written")
+endif()
+
+# 一个文件出错不影响其它文件，退出码取最大的
+run_cc0(0 "" -s src/sub/b.c0 -o b.s)
+run_cc0(2 "src/bad\\.c0: Err at" -s src/bad.c0 src/sub/b.c0 -o out-err)
+expect_same("${WORK}/out-err/b.s" "${WORK}/b.s")
+
+run_cc0(2 "Fail to open missing\\.rsp" @missing.rsp)
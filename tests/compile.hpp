@@ -0,0 +1,49 @@
+#pragma once
+
+#include "analyser/analyser.h"
+#include "backend/program.h"
+#include "tokenizer/tokenizer.h"
+
+#include <sstream>
+#include <string>
+
+namespace miniplc0 {
+	// 把一段 c0 源码编译好，供 VM 和后端的测试使用。指令归内部的 Analyser 所有
+	class TestCompilation {
+	public:
+		// pool 不为空时和 cc0 -jN 一样并行生成各个函数的代码
+		explicit TestCompilation(const std::string& source, ThreadPool* pool = nullptr)
+			: _input(source), _interner(), _tokenizer(_input, _interner), _analyser(_tokenizer, pool), _ok(false) {
+			auto result = _analyser.Analyse();
+			_ok = !_analyser._lex_error.has_value() && !result.second.has_value();
+		}
+		TestCompilation(TestCompilation&&) = delete;
+		TestCompilation(const TestCompilation&) = delete;
+		TestCompilation& operator=(TestCompilation) = delete;
+
+		bool Ok() const { return _ok; }
+		const Analyser& GetAnalyser() const { return _analyser; }
+
+		// cc0 -c 的输出
+		std::string Binary() {
+			std::ostringstream out;
+			_analyser.printBinary(out);
+			return out.str();
+		}
+
+		// 后端的输入，和 cc0 --emit-c / --emit-asm 给出的相同
+		Program GetProgram() const {
+			Program p{ &_analyser._Sins, {} };
+			for (auto f : _analyser._funcList)
+				p.functions.push_back(ProgramFunction{ std::string(_interner.Lookup(f->name)), f->num_par, f->level,
+					&_analyser._Ains[f->index] });
+			return p;
+		}
+	private:
+		std::istringstream _input;
+		StringInterner _interner;
+		Tokenizer _tokenizer;
+		Analyser _analyser;
+		bool _ok;
+	};
+}
@@ -0,0 +1,211 @@
+#include "catch2/catch.hpp"
+
+#include "tests/compile.hpp"
+#include "vm/vm.h"
+
+#include <climits>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+using namespace miniplc0;
+
+namespace {
+
+	// main 中某个操作出现的次数
+	std::size_t countInMain(const TestCompilation& c, Operation opr) {
+		auto& analyser = c.GetAnalyser();
+		auto& code = analyser._Ains[analyser._funcList.back()->index];
+		std::size_t n = 0;
+		for (auto& ins : code)
+			n += ins.GetOperation() == opr;
+		return n;
+	}
+
+	bool pushesInMain(const TestCompilation& c, int32_t value) {
+		auto& analyser = c.GetAnalyser();
+		for (auto& ins : analyser._Ains[analyser._funcList.back()->index])
+			if ((ins.GetOperation() == Operation::ipush || ins.GetOperation() == Operation::bipush) && ins.GetX() == value)
+				return true;
+		return false;
+	}
+
+	// 编译并执行，返回运行时错误
+	std::optional<VMError> run(TestCompilation& c, std::string& output) {
+		auto image = c.Binary();
+		auto loaded = LoadModule(reinterpret_cast<const std::uint8_t*>(image.data()), image.size());
+		REQUIRE_FALSE(loaded.second.has_value());
+		std::istringstream in;
+		std::ostringstream out;
+		VM vm(loaded.first, in, out);
+		auto err = vm.Run();
+		output = out.str();
+		return err;
+	}
+}
+
+TEST_CASE("Function table records the max stack depth", "[analyser]") {
+	// 循环里作为语句调用 int 函数，返回值被弹掉，深度可以静态确定
+	TestCompilation c(
+		"int f(int x) { return x; }\n"
+		"int main() { int i; i = 0; while (i < 3) { f(i); i = i + 1; } return 0; }\n");
+	REQUIRE(c.Ok());
+	auto& funcs = c.GetAnalyser()._funcList;
+	REQUIRE(funcs.size() == 2);
+	// f：参数 + loada/iload 的值
+	REQUIRE(funcs[0]->max_stack == 2);
+	// main：i + 地址 + i + 1
+	REQUIRE(funcs[1]->max_stack == 4);
+}
+
+TEST_CASE("The value of a void function cannot be used", "[analyser]") {
+	TestCompilation c("void g() {}\nint main() { print(g()); return 0; }\n");
+	REQUIRE_FALSE(c.Ok());
+}
+
+TEST_CASE("Calls must pass as many arguments as the callee takes", "[analyser]") {
+	auto error = [](const std::string& source) {
+		TestCompilation c(source);
+		REQUIRE_FALSE(c.Ok());
+		std::istringstream in(source);
+		StringInterner interner;
+		Tokenizer tkz(in, interner);
+		Analyser analyser(tkz);
+		return analyser.Analyse().second.value().GetCode();
+	};
+	std::string f = "int f(int x) { return x; }\nvoid g() {}\n";
+	REQUIRE(error(f + "int main() { print(f()); return 0; }\n") == ErrArgCount);
+	REQUIRE(error(f + "int main() { int i = 0; while (i < 3) { f(1, 2); i = i + 1; } return 0; }\n") == ErrArgCount);
+	REQUIRE(error(f + "int main() { g(1); return 0; }\n") == ErrArgCount);
+	REQUIRE(error(f + "int main() { print(f(1,)); return 0; }\n") == ErrIncompleteExpression);
+
+	TestCompilation ok(f + "int main() { g(); print(f(f(2))); return 0; }\n");
+	REQUIRE(ok.Ok());
+}
+
+TEST_CASE("Lookahead works at every position of the token ring", "[analyser]") {
+	// 每个声明占 3 或 6 个 token，k 取遍 0..15 时函数定义前的回看会落在环的每个位置上
+	for (int k = 0; k < 16; k++) {
+		std::string source;
+		for (int i = 0; i < k; i++)
+			source += i % 2 == 0 ? "int g" + std::to_string(i) + ";\n"
+				: "const int g" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+		source +=
+			"int f(int a, int b) { return a - b; }\n"
+			"void g(int a) { print(a); }\n"
+			"int main() { int x = 5; g(f(x, 2)); x = f(x, 1); print(x); return 0; }\n";
+		INFO(source);
+		TestCompilation c(source);
+		REQUIRE(c.Ok());
+		auto& funcs = c.GetAnalyser()._funcList;
+		REQUIRE(funcs.size() == 3);
+		REQUIRE(funcs[0]->num_par == 2);
+		REQUIRE(funcs[1]->num_par == 1);
+		REQUIRE(funcs[2]->num_par == 0);
+
+		auto image = c.Binary();
+		auto loaded = LoadModule(reinterpret_cast<const std::uint8_t*>(image.data()), image.size());
+		REQUIRE_FALSE(loaded.second.has_value());
+		std::istringstream in;
+		std::ostringstream out;
+		VM vm(loaded.first, in, out);
+		REQUIRE_FALSE(vm.Run().has_value());
+		REQUIRE(out.str() == "3\n4\n");
+	}
+}
+
+TEST_CASE("Literal arithmetic is folded at compile time", "[analyser][fold]") {
+	std::string output;
+
+	SECTION("binary operators") {
+		TestCompilation c("int main() { print(2 * 3 + 4, 100 / 7 - 20); return 0; }\n");
+		REQUIRE(c.Ok());
+		for (auto opr : { Operation::iadd, Operation::isub, Operation::imul, Operation::idiv })
+			REQUIRE(countInMain(c, opr) == 0);
+		REQUIRE(pushesInMain(c, 10));
+		REQUIRE(pushesInMain(c, -6));
+		REQUIRE_FALSE(run(c, output).has_value());
+		REQUIRE(output == "10 -6\n");
+	}
+
+	SECTION("negation") {
+		TestCompilation c("int main() { print(-7, -(-(3 - 5)), -2147483647 - 1); return 0; }\n");
+		REQUIRE(c.Ok());
+		REQUIRE(countInMain(c, Operation::ineg) == 0);
+		REQUIRE(countInMain(c, Operation::isub) == 0);
+		REQUIRE(pushesInMain(c, INT_MIN));
+		REQUIRE_FALSE(run(c, output).has_value());
+		REQUIRE(output == "-7 -2 -2147483648\n");
+	}
+
+	SECTION("only literal operands") {
+		TestCompilation c("int main() { int x = 4; print(x * 2 + 1); return 0; }\n");
+		REQUIRE(c.Ok());
+		REQUIRE(countInMain(c, Operation::imul) == 1);
+		REQUIRE(countInMain(c, Operation::iadd) == 1);
+	}
+}
+
+TEST_CASE("Arithmetic that would trap is left for run time", "[analyser][fold]") {
+	std::string output;
+	auto expectTrap = [&](const std::string& expr, Operation opr, VMErrorCode code) {
+		INFO(expr);
+		TestCompilation c("int main() { print(1); print(" + expr + "); return 0; }\n");
+		REQUIRE(c.Ok());
+		REQUIRE(countInMain(c, opr) == 1);
+		auto err = run(c, output);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == code);
+		REQUIRE(output == "1\n");
+	};
+	expectTrap("2147483647 + 1", Operation::iadd, VMIntegerOverflow);
+	expectTrap("-2147483647 - 2", Operation::isub, VMIntegerOverflow);
+	expectTrap("65536 * 65536", Operation::imul, VMIntegerOverflow);
+	expectTrap("7 / 0", Operation::idiv, VMDivideByZero);
+	expectTrap("(-2147483647 - 1) / -1", Operation::idiv, VMIntegerOverflow);
+	expectTrap("-(-2147483647 - 1)", Operation::ineg, VMIntegerOverflow);
+}
+
+TEST_CASE("Parallel code generation gives the same binary as serial", "[analyser][parallel]") {
+	// 函数体长短不一，让各个任务以不同的顺序完成
+	std::string source = "int g;\n";
+	for (int i = 0; i < 40; i++) {
+		source += "int f" + std::to_string(i) + "(int n) { int s = " + std::to_string(i) + ";";
+		for (int j = 0; j < i % 7; j++)
+			source += " while (n > " + std::to_string(j) + ") { s = s + n * " + std::to_string(j + 1) + "; n = n - 1; }";
+		source += " return s; }\n";
+	}
+	source += "int main() { g = f39(5) + f13(4); print(g); return 0; }\n";
+
+	TestCompilation serial(source);
+	REQUIRE(serial.Ok());
+	auto expected = serial.Binary();
+	for (std::size_t jobs : { 2, 4, 8 }) {
+		ThreadPool pool(jobs);
+		for (int round = 0; round < 5; round++) {
+			INFO("jobs " << jobs << ", round " << round);
+			TestCompilation parallel(source, &pool);
+			REQUIRE(parallel.Ok());
+			REQUIRE(parallel.Binary() == expected);
+		}
+	}
+}
+
+TEST_CASE("Stack analysis of a function with many locals", "[analyser]") {
+	// 每条指令只记深度，局部变量再多分析也是线性的
+	const int n = 1500;
+	std::string source = "int main() {\n";
+	for (int i = 0; i < n; i++)
+		source += "int v" + std::to_string(i) + " = " + std::to_string(i) + ";\n";
+	for (int i = 1; i < n; i++)
+		source += "v" + std::to_string(i) + " = v" + std::to_string(i) + " + v" + std::to_string(i - 1) + ";\n";
+	source += "print(v" + std::to_string(n - 1) + ");\nreturn 0;\n}\n";
+
+	TestCompilation c(source);
+	REQUIRE(c.Ok());
+	// 局部变量 + 地址 + 两个操作数
+	REQUIRE(c.GetAnalyser()._funcList[0]->max_stack == n + 3);
+	std::string output;
+	REQUIRE_FALSE(run(c, output).has_value());
+	REQUIRE(output == std::to_string((long long)n * (n - 1) / 2) + "\n");
+}
@@ -0,0 +1,38 @@
+#include "catch2/catch.hpp"
+
+#include "tests/compile.hpp"
+#include "backend/emit_c.h"
+#include "backend/emit_asm.h"
+
+#include <sstream>
+#include <string>
+
+using namespace miniplc0;
+
+namespace {
+
+	// 作为语句调用 int 函数：返回值要弹掉，否则循环汇合处的栈深度不一致，后端无法翻译
+	const char* const kCallInLoop =
+		"int f(int x) { return x; }\n"
+		"int main() { int i; i = 0; while (i < 3) { f(i); i = i + 1; } return 0; }\n";
+}
+
+TEST_CASE("C backend translates an int call statement in a loop", "[backend]") {
+	TestCompilation c(kCallInLoop);
+	REQUIRE(c.Ok());
+	std::ostringstream out;
+	auto err = EmitC(c.GetProgram(), out);
+	REQUIRE_FALSE(err.has_value());
+	REQUIRE(out.str().find("int main(void)") != std::string::npos);
+}
+
+TEST_CASE("Assembly backend translates an int call statement in a loop", "[backend]") {
+	TestCompilation c(kCallInLoop);
+	REQUIRE(c.Ok());
+	std::ostringstream out;
+	auto err = EmitAsm(c.GetProgram(), out);
+	REQUIRE_FALSE(err.has_value());
+	REQUIRE(out.str().find("_start:") != std::string::npos);
+	// 没有这一节时链接出的程序的栈是可执行的
+	REQUIRE(out.str().find(".section .note.GNU-stack,\"\",@progbits") != std::string::npos);
+}
@@ -0,0 +1,115 @@
+#include "catch2/catch.hpp"
+
+#include "instruction/peephole.h"
+
+#include <vector>
+
+using namespace miniplc0;
+
+namespace {
+
+	std::vector<Instruction> optimise(std::vector<Instruction> code) {
+		Peephole(code);
+		return code;
+	}
+}
+
+TEST_CASE("Peephole rules rewrite local windows", "[peephole]") {
+	SECTION("x + 0 is dropped") {
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(bipush, 0), Instruction(iadd), Instruction(iprint), Instruction(ret)
+		};
+		std::vector<Instruction> expected{ Instruction(iscan), Instruction(iprint), Instruction(ret) };
+		REQUIRE(optimise(code) == expected);
+	}
+
+	SECTION("a jump into the middle of a window keeps the window") {
+		// 4 是 x + 0 窗口的第二条，被 jne 跳到
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(iscan), Instruction(jne, 4), Instruction(bipush, 0),
+			Instruction(iadd), Instruction(iprint), Instruction(ret)
+		};
+		REQUIRE(optimise(code) == code);
+	}
+
+	SECTION("a double negation is kept") {
+		// -(-x) 在 x 为 INT_MIN 时第一次取负就要报溢出
+		std::vector<Instruction> code{ Instruction(iscan), Instruction(ineg), Instruction(ineg), Instruction(iret) };
+		REQUIRE(optimise(code) == code);
+	}
+
+	SECTION("small ipush becomes bipush") {
+		std::vector<Instruction> code{ Instruction(ipush, 200), Instruction(ipush, 256), Instruction(iret) };
+		std::vector<Instruction> expected{ Instruction(bipush, 200), Instruction(ipush, 256), Instruction(iret) };
+		REQUIRE(optimise(code) == expected);
+	}
+}
+
+TEST_CASE("Peephole renumbers jumps", "[peephole]") {
+	SECTION("a jump to a deleted nop lands on the next kept instruction") {
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(nop), Instruction(je, 5), Instruction(bipush, 1),
+			Instruction(iprint), Instruction(nop), Instruction(printl), Instruction(ret)
+		};
+		std::vector<Instruction> expected{
+			Instruction(iscan), Instruction(je, 4), Instruction(bipush, 1), Instruction(iprint),
+			Instruction(printl), Instruction(ret)
+		};
+		REQUIRE(optimise(code) == expected);
+	}
+
+	SECTION("a jump to a deleted jmp lands on that jmp's target") {
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(je, 4), Instruction(bipush, 1), Instruction(iprint),
+			Instruction(jmp, 5), Instruction(printl), Instruction(ret)
+		};
+		std::vector<Instruction> expected{
+			Instruction(iscan), Instruction(je, 4), Instruction(bipush, 1), Instruction(iprint),
+			Instruction(printl), Instruction(ret)
+		};
+		REQUIRE(optimise(code) == expected);
+	}
+
+	SECTION("a chain of jmps is threaded to its final target") {
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(je, 6), Instruction(bipush, 1), Instruction(iprint),
+			Instruction(printl), Instruction(ret), Instruction(jmp, 8), Instruction(ret), Instruction(jmp, 4)
+		};
+		std::vector<Instruction> expected{
+			Instruction(iscan), Instruction(je, 4), Instruction(bipush, 1), Instruction(iprint),
+			Instruction(printl), Instruction(ret)
+		};
+		REQUIRE(optimise(code) == expected);
+	}
+
+	SECTION("a jmp to a return becomes the return") {
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(je, 4), Instruction(printl), Instruction(jmp, 6),
+			Instruction(bipush, 1), Instruction(iprint), Instruction(ret)
+		};
+		std::vector<Instruction> expected{
+			Instruction(iscan), Instruction(je, 4), Instruction(printl), Instruction(ret),
+			Instruction(bipush, 1), Instruction(iprint), Instruction(ret)
+		};
+		REQUIRE(optimise(code) == expected);
+	}
+
+	SECTION("a loop made only of jmps stays a loop") {
+		std::vector<Instruction> code{
+			Instruction(iscan), Instruction(je, 3), Instruction(ret), Instruction(jmp, 4), Instruction(jmp, 3)
+		};
+		// jmp 4 跳到下一条被删掉，剩下的 jmp 跳到自己
+		std::vector<Instruction> expected{
+			Instruction(iscan), Instruction(je, 3), Instruction(ret), Instruction(jmp, 3)
+		};
+		REQUIRE(optimise(code) == expected);
+	}
+}
+
+TEST_CASE("Peephole removes unreachable code", "[peephole]") {
+	std::vector<Instruction> code{
+		Instruction(bipush, 1), Instruction(iret), Instruction(bipush, 2), Instruction(iprint), Instruction(ret)
+	};
+	std::vector<Instruction> expected{ Instruction(bipush, 1), Instruction(iret) };
+	REQUIRE(optimise(code) == expected);
+}
@@ -0,0 +1,272 @@
+#include "catch2/catch.hpp"
+
+#include "tokenizer/keywords.h"
+#include "tokenizer/tokenizer.h"
+
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace miniplc0;
+
+namespace {
+
+	// 把 source 切成 token，出错时 err 为第一个错误
+	std::vector<Token> lex(const std::string& source, StringInterner& interner, std::optional<CompilationError>& err) {
+		std::istringstream in(source);
+		Tokenizer tkz(in, interner);
+		auto result = tkz.AllTokens();
+		err = result.second;
+		return result.first;
+	}
+
+	std::vector<Token> lex(const std::string& source, StringInterner& interner) {
+		std::optional<CompilationError> err;
+		auto tokens = lex(source, interner, err);
+		REQUIRE_FALSE(err.has_value());
+		return tokens;
+	}
+}
+
+TEST_CASE("Tokens carry their type, payload and source range", "[tokenizer]") {
+	StringInterner interner;
+	auto tokens = lex("foo = 42;\nbar1", interner);
+	REQUIRE(tokens.size() == 5);
+
+	REQUIRE(tokens[0].GetType() == IDENTIFIER);
+	REQUIRE(interner.Lookup(tokens[0].GetId()) == "foo");
+	REQUIRE(tokens[0].GetStart() == 0);
+	REQUIRE(tokens[0].GetEnd() == 3);
+
+	// 单字符符号的负载是该字符
+	REQUIRE(tokens[1] == Token(FZ, '=', 4, 5));
+	REQUIRE(tokens[2] == Token(UNSIGNED_INTEGER, 42, 6, 8));
+	REQUIRE(tokens[3] == Token(SEMICOLON, ';', 8, 9));
+
+	REQUIRE(tokens[4].GetType() == IDENTIFIER);
+	REQUIRE(interner.Lookup(tokens[4].GetId()) == "bar1");
+	REQUIRE(tokens[4].GetStart() == 10);
+	REQUIRE(tokens[4].GetEnd() == 14);
+}
+
+TEST_CASE("The same identifier always gets the same id", "[tokenizer]") {
+	StringInterner interner;
+	auto tokens = lex("a b a ab b", interner);
+	REQUIRE(tokens.size() == 5);
+	REQUIRE(tokens[0].GetId() == tokens[2].GetId());
+	REQUIRE(tokens[1].GetId() == tokens[4].GetId());
+	REQUIRE(tokens[0].GetId() != tokens[1].GetId());
+	REQUIRE(tokens[3].GetId() != tokens[0].GetId());
+	REQUIRE(interner.Size() == 3);
+	REQUIRE(interner.Find("ab") == tokens[3].GetId());
+	REQUIRE(interner.Find("c") == -1);
+}
+
+TEST_CASE("Every keyword and its near misses", "[tokenizer][keyword]") {
+	StringInterner interner;
+	auto isKeyword = [](const std::string& s) {
+		for (auto& kw : keywords::kKeywords)
+			if (kw.name == s)
+				return true;
+		return false;
+	};
+	for (auto& kw : keywords::kKeywords) {
+		std::string name(kw.name);
+		auto tokens = lex(name, interner);
+		REQUIRE(tokens.size() == 1);
+		REQUIRE(tokens[0].GetType() == kw.type);
+
+		// 散列只看首尾字符和长度，所以改中间字符的拼写最容易误判
+		std::vector<std::string> misses = { name + "x", "x" + name, name.substr(0, name.size() - 1), name + "1" };
+		auto upper = name;
+		upper[0] = static_cast<char>(upper[0] - 'a' + 'A');
+		misses.push_back(upper);
+		if (name.size() > 2) {
+			auto middle = name;
+			middle[1] = middle[1] == 'z' ? 'y' : 'z';
+			misses.push_back(middle);
+		}
+		for (auto& miss : misses) {
+			if (miss.empty() || isKeyword(miss))
+				continue;
+			INFO(miss);
+			tokens = lex(miss, interner);
+			REQUIRE(tokens.size() == 1);
+			REQUIRE(tokens[0].GetType() == IDENTIFIER);
+			REQUIRE(interner.Lookup(tokens[0].GetId()) == miss);
+		}
+	}
+	REQUIRE(lex("continues", interner)[0].GetType() == IDENTIFIER);
+	REQUIRE(lex("if(", interner)[0].GetType() == IF);
+}
+
+TEST_CASE("Numbers and symbols", "[tokenizer]") {
+	StringInterner interner;
+
+	SECTION("decimal and hexadecimal literals") {
+		auto tokens = lex("0 7 2147483647 0x1f 0XFF", interner);
+		REQUIRE(tokens.size() == 5);
+		for (auto& t : tokens)
+			REQUIRE(t.GetType() == UNSIGNED_INTEGER);
+		REQUIRE(tokens[0].GetValue() == 0);
+		REQUIRE(tokens[1].GetValue() == 7);
+		REQUIRE(tokens[2].GetValue() == 2147483647);
+		REQUIRE(tokens[3].GetValue() == 31);
+		REQUIRE(tokens[4].GetValue() == 255);
+	}
+
+	SECTION("one- and two-character operators") {
+		auto tokens = lex("+-*/<<=>>= == = !=(){}[],:", interner);
+		std::vector<TokenType> expected{
+			PLUS, MINUS, STAR, _DIV, LESS, LOE, GREATER, GOE, EQ, FZ, NE, ZKH, YKH, ZDKH, YDKH, ZZKH, YZKH, DOUHAO, COLON
+		};
+		REQUIRE(tokens.size() == expected.size());
+		for (std::size_t i = 0; i < expected.size(); i++)
+			REQUIRE(tokens[i].GetType() == expected[i]);
+	}
+
+	SECTION("character literals are not part of the language") {
+		std::optional<CompilationError> err;
+		lex("'a'", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrInvalidInput);
+	}
+
+	SECTION("an identifier cannot start with a digit") {
+		std::optional<CompilationError> err;
+		lex("x 1abc", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrInvalidIdentifier);
+	}
+
+	SECTION("a lone ! is invalid") {
+		std::optional<CompilationError> err;
+		lex("a ! b", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrInvalidInput);
+	}
+}
+
+TEST_CASE("SourceBuffer maps offsets to lines and columns", "[tokenizer][source]") {
+	std::istringstream in("int a;\n\n  b\nc");
+	SourceBuffer src(in);
+	REQUIRE(src.Size() == 13);
+	REQUIRE(src.PosOf(0) == std::make_pair<std::uint64_t, std::uint64_t>(0, 0));
+	REQUIRE(src.PosOf(5) == std::make_pair<std::uint64_t, std::uint64_t>(0, 5));
+	// 换行符属于它所在的行
+	REQUIRE(src.PosOf(6) == std::make_pair<std::uint64_t, std::uint64_t>(0, 6));
+	REQUIRE(src.PosOf(7) == std::make_pair<std::uint64_t, std::uint64_t>(1, 0));
+	REQUIRE(src.PosOf(10) == std::make_pair<std::uint64_t, std::uint64_t>(2, 2));
+	REQUIRE(src.PosOf(12) == std::make_pair<std::uint64_t, std::uint64_t>(3, 0));
+	REQUIRE(src.PosOf(13) == std::make_pair<std::uint64_t, std::uint64_t>(3, 1));
+	// 越过末尾的偏移落在最后一行之后
+	REQUIRE(src.PosOf(100) == std::make_pair<std::uint64_t, std::uint64_t>(4, 0));
+}
+
+TEST_CASE("SourceBuffer reads files by mapping them", "[tokenizer][source]") {
+	auto path = std::filesystem::temp_directory_path() / "cc0_test_source.c0";
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << "int x;\n  $";
+	}
+	SourceBuffer src;
+	REQUIRE(src.Open(path.string()));
+	REQUIRE(std::string(src.Data(), src.Size()) == "int x;\n  $");
+
+	// 从映射的缓冲区扫描，错误位置换算成行列号
+	StringInterner interner;
+	Tokenizer tkz(src, interner);
+	auto result = tkz.AllTokens();
+	REQUIRE(result.second.has_value());
+	REQUIRE(result.second.value().GetCode() == ErrInvalidInput);
+	REQUIRE(result.second.value().GetPos() == std::make_pair<std::uint64_t, std::uint64_t>(1, 2));
+
+	// 空文件不能映射，退化为读入
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	}
+	REQUIRE(src.Open(path.string()));
+	REQUIRE(src.Size() == 0);
+	std::filesystem::remove(path);
+	REQUIRE_FALSE(src.Open(path.string()));
+}
+
+TEST_CASE("Runs and comments that cross 16-byte blocks", "[tokenizer][simd]") {
+	StringInterner interner;
+
+	SECTION("identifiers and numbers of every length up to 40") {
+		// 向量扫描每次看 16 字节，长度跨过 16、32 时都要在正确的位置停下
+		for (std::size_t len = 1; len <= 40; len++) {
+			std::string name(len, 'a');
+			name[len - 1] = 'Z';
+			std::string digits(len < 10 ? len : 9, '7');
+			auto tokens = lex(" " + name + "+" + digits + ";", interner);
+			REQUIRE(tokens.size() == 4);
+			REQUIRE(interner.Lookup(tokens[0].GetId()) == name);
+			REQUIRE(tokens[1].GetType() == PLUS);
+			REQUIRE(tokens[2].GetEnd() - tokens[2].GetStart() == digits.size());
+			REQUIRE(tokens[2].GetValue() == std::stoi(digits));
+			REQUIRE(tokens[3].GetType() == SEMICOLON);
+		}
+	}
+
+	SECTION("leading zeros longer than a block") {
+		auto tokens = lex(std::string(20, '0') + "12 x", interner);
+		REQUIRE(tokens.size() == 2);
+		REQUIRE(tokens[0].GetValue() == 12);
+	}
+
+	SECTION("block comments that end on either side of a block boundary") {
+		for (std::size_t pad = 0; pad < 20; pad++) {
+			// 关闭的 */ 依次落在第 16、17 字节附近，中间夹着不成对的 *
+			auto source = "a /*" + std::string(pad, '*') + " * /" + "*/ b";
+			auto tokens = lex(source, interner);
+			REQUIRE(tokens.size() == 2);
+			REQUIRE(interner.Lookup(tokens[1].GetId()) == "b");
+		}
+	}
+
+	SECTION("line comments stop at the newline") {
+		auto tokens = lex("a // " + std::string(30, 'x') + " */\nb//\r\nc // end", interner);
+		REQUIRE(tokens.size() == 3);
+		REQUIRE(interner.Lookup(tokens[2].GetId()) == "c");
+	}
+}
+
+TEST_CASE("Lexical errors", "[tokenizer]") {
+	StringInterner interner;
+	std::optional<CompilationError> err;
+
+	SECTION("an unterminated block comment is reported where it starts") {
+		lex("a\n  /* never closed " + std::string(40, '*'), interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrInvalidInput);
+		REQUIRE(err.value().GetPos() == std::make_pair<std::uint64_t, std::uint64_t>(1, 2));
+	}
+
+	SECTION("a comment closed only by a trailing *") {
+		lex("a /* *", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrInvalidInput);
+	}
+
+	SECTION("a decimal literal that does not fit in int") {
+		lex("x = 2147483648;", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrIntegerOverflow);
+		REQUIRE(err.value().GetPos() == std::make_pair<std::uint64_t, std::uint64_t>(0, 4));
+		lex("99999999999999999999999", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrIntegerOverflow);
+	}
+
+	SECTION("a hexadecimal literal that does not fit in int") {
+		lex("0x7fffffff", interner, err);
+		REQUIRE_FALSE(err.has_value());
+		lex("0x80000000", interner, err);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == ErrIntegerOverflow);
+	}
+}
@@ -0,0 +1,79 @@
+#include "catch2/catch.hpp"
+
+#include "vm/vm.h"
+
+#include <vector>
+
+using namespace miniplc0;
+
+namespace {
+
+	// 只有一个层次为 1 的函数 main 的模块；.start 留下 globals 个全局变量
+	Module makeModule(std::vector<Instruction> code, std::int32_t globals = 0, std::int32_t max_stack = -1) {
+		Module m;
+		m.constants.push_back(VMConstant{ 'S', "main", 0, 0.0 });
+		for (std::int32_t k = 0; k < globals; k++)
+			m.start.emplace_back(bipush, k);
+		m.functions.push_back(VMFunction{ 0, 0, 1, std::move(code), max_stack, 0, 0 });
+		m.verified = false;
+		m.start_depth = 0;
+		return m;
+	}
+
+	void requireRejected(Module& m, std::int32_t pc) {
+		auto err = VerifyModule(m);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == VMUnverified);
+		REQUIRE(err.value().GetFunction() == 0);
+		REQUIRE(err.value().GetPc() == pc);
+		REQUIRE_FALSE(m.verified);
+	}
+}
+
+TEST_CASE("Verifier rejects malformed code", "[vm][verify]") {
+	SECTION("different stack depths where two paths merge") {
+		// 跳到 3 时栈为空，顺序执行到 3 时栈上多一个值
+		auto m = makeModule({ Instruction(iscan), Instruction(je, 3), Instruction(bipush, 1), Instruction(ret) });
+		requireRejected(m, 2);
+	}
+
+	SECTION("loada at a level that is neither the frame nor the globals") {
+		auto m = makeModule({ Instruction(loada, 2, 0), Instruction(iload), Instruction(iprint), Instruction(ret) });
+		requireRejected(m, 0);
+	}
+
+	SECTION("a global slot that .start does not create") {
+		auto m = makeModule({ Instruction(loada, 1, 3), Instruction(iload), Instruction(iprint), Instruction(ret) }, 2);
+		requireRejected(m, 1);
+	}
+
+	SECTION("ret in a function that also returns with iret") {
+		auto m = makeModule({
+			Instruction(iscan), Instruction(je, 4), Instruction(bipush, 1), Instruction(iret), Instruction(ret)
+		});
+		requireRejected(m, 4);
+	}
+
+	SECTION("a recorded max_stack below the analysed depth") {
+		auto m = makeModule({
+			Instruction(bipush, 1), Instruction(bipush, 2), Instruction(iadd), Instruction(iprint), Instruction(ret)
+		}, 0, 1);
+		auto err = VerifyModule(m);
+		REQUIRE(err.has_value());
+		REQUIRE(err.value().GetCode() == VMUnverified);
+		REQUIRE(err.value().GetFunction() == 0);
+		REQUIRE_FALSE(m.verified);
+	}
+}
+
+TEST_CASE("Verifier accepts well-formed code", "[vm][verify]") {
+	auto m = makeModule({
+		Instruction(loada, 1, 0), Instruction(iload), Instruction(bipush, 2), Instruction(iadd), Instruction(iprint),
+		Instruction(ret)
+	}, 1, 2);
+	auto err = VerifyModule(m);
+	REQUIRE_FALSE(err.has_value());
+	REQUIRE(m.verified);
+	REQUIRE(m.start_depth == 1);
+	REQUIRE(m.functions[0].max_depth == 2);
+}
@@ -0,0 +1,178 @@
+#include "catch2/catch.hpp"
+
+#include "instruction/binary.h"
+#include "tests/compile.hpp"
+#include "vm/vm.h"
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+using namespace miniplc0;
+
+namespace {
+
+	// 用解释器或者 JIT 执行 main，返回输出
+	std::string run(const Module& module, bool jit, bool& native) {
+		std::istringstream in;
+		std::ostringstream out;
+		VM vm(module, in, out);
+		vm.SetJit(jit);
+		auto err = vm.Run();
+		REQUIRE_FALSE(err.has_value());
+		native = vm.IsNative(FindFunction(module, "fib"));
+		return out.str();
+	}
+
+	void compareFib(const std::string& source) {
+		TestCompilation c(source);
+		REQUIRE(c.Ok());
+		auto image = c.Binary();
+		auto loaded = LoadModule(reinterpret_cast<const std::uint8_t*>(image.data()), image.size());
+		REQUIRE_FALSE(loaded.second.has_value());
+		REQUIRE(loaded.first.verified);
+
+		bool native = false;
+		auto interpreted = run(loaded.first, false, native);
+		REQUIRE(interpreted == "6765\n");
+		REQUIRE_FALSE(native);
+		auto jitted = run(loaded.first, true, native);
+		REQUIRE(jitted == interpreted);
+#if defined(MINIPLC0_VM_JIT) && defined(__x86_64__) && defined(__unix__)
+		REQUIRE(native);
+#endif
+	}
+}
+
+TEST_CASE("Interpreter and JIT agree on fib", "[vm][jit]") {
+	SECTION("call results used directly in the expression") {
+		compareFib(
+			"int fib(int n) { if (n < 2) return n; return fib(n - 1) + fib(n - 2); }\n"
+			"int main() { print(fib(20)); return 0; }\n");
+	}
+
+	SECTION("call results assigned to locals first") {
+		// x = f(...) 要合并成 STORE_LOCAL 才能被 JIT 编译
+		compareFib(
+			"int fib(int n) { int a; int b; if (n < 2) return n; a = fib(n - 1); b = fib(n - 2); return a + b; }\n"
+			"int main() { print(fib(20)); return 0; }\n");
+	}
+}
+
+TEST_CASE("A compiled module loads back with the same function table", "[vm][loader]") {
+	TestCompilation c(
+		"int g = 3;\n"
+		"void show(int x) { print(x); }\n"
+		"int sum(int n) { int s = 0; while (n > 0) { if (n > 5) { s = s + n; } else { s = s - 1; } n = n - 1; } return s; }\n"
+		"int main() { show(sum(10)); print(g); return 0; }\n");
+	REQUIRE(c.Ok());
+	auto image = c.Binary();
+	auto loaded = LoadModule(reinterpret_cast<const std::uint8_t*>(image.data()), image.size());
+	REQUIRE_FALSE(loaded.second.has_value());
+	auto& module = loaded.first;
+	REQUIRE(module.verified);
+
+	auto& analyser = c.GetAnalyser();
+	REQUIRE(module.start == analyser._Sins);
+	REQUIRE(module.constants.size() == 3);
+	REQUIRE(module.functions.size() == 3);
+	const char* names[] = { "show", "sum", "main" };
+	for (std::size_t i = 0; i < 3; i++) {
+		auto f = analyser._funcList[i];
+		auto& loadedFunc = module.functions[i];
+		INFO(names[i]);
+		REQUIRE(module.constants[loadedFunc.name_index].type == 'S');
+		REQUIRE(module.constants[loadedFunc.name_index].str == names[i]);
+		REQUIRE(loadedFunc.num_par == f->num_par);
+		REQUIRE(loadedFunc.level == 1);
+		REQUIRE(loadedFunc.max_stack == f->max_stack);
+		REQUIRE(loadedFunc.num_local == f->num_local);
+		// 跳转目标按原样写出、原样读回
+		REQUIRE(loadedFunc.code == analyser._Ains[f->index]);
+	}
+	REQUIRE(FindFunction(module, "sum") == 1);
+
+	std::istringstream in;
+	std::ostringstream out;
+	VM vm(module, in, out);
+	REQUIRE_FALSE(vm.Run().has_value());
+	REQUIRE(out.str() == "35\n3\n");
+}
+
+TEST_CASE("Loading without verification keeps the checked interpreter", "[vm][loader]") {
+	TestCompilation c("int f(int n) { if (n < 2) { return n; } return f(n - 1) + f(n - 2); }\nint main() { print(f(15)); return 0; }\n");
+	REQUIRE(c.Ok());
+	auto image = c.Binary();
+	auto loaded = LoadModule(reinterpret_cast<const std::uint8_t*>(image.data()), image.size(), false);
+	REQUIRE_FALSE(loaded.second.has_value());
+	REQUIRE_FALSE(loaded.first.verified);
+
+	std::istringstream in;
+	std::ostringstream out;
+	VM vm(loaded.first, in, out);
+	REQUIRE_FALSE(vm.Run().has_value());
+	REQUIRE(out.str() == "610\n");
+}
+
+TEST_CASE("Version 1 images without stack depths still load", "[vm][loader]") {
+	// version 1 的函数表只有 name_index、num_par、level，深度要在加载时算出
+	auto image = [](std::uint32_t version) {
+		BinaryWriter out;
+		out.PutU32(0x43303a29);
+		out.PutU32(version);
+		out.PutU16(2);
+		for (auto name : { "twice", "main" }) {
+			out.PutU8(0x00);
+			out.PutU16((std::uint16_t)std::string(name).size());
+			out.PutBytes(name);
+		}
+		std::vector<Instruction> start{ Instruction(bipush, 20) };
+		out.PutU16((std::uint16_t)start.size());
+		for (auto& ins : start)
+			out.PutInstruction(ins);
+		std::vector<Instruction> twice{
+			Instruction(loada, 0, 0), Instruction(iload), Instruction(bipush, 2), Instruction(imul), Instruction(iret)
+		};
+		std::vector<Instruction> main{
+			Instruction(loada, 1, 0), Instruction(iload), Instruction(bipush, 1), Instruction(iadd), Instruction(call, 0),
+			Instruction(iprint), Instruction(printl), Instruction(ret)
+		};
+		out.PutU16(2);
+		for (std::uint16_t f = 0; f < 2; f++) {
+			auto& code = f == 0 ? twice : main;
+			out.PutU16(f);
+			out.PutU16(f == 0 ? 1 : 0);
+			out.PutU16(1);
+			if (version == 2) {
+				out.PutU16(3);
+				out.PutU16(f == 0 ? 1 : 0);
+			}
+			out.PutU16((std::uint16_t)code.size());
+			for (auto& ins : code)
+				out.PutInstruction(ins);
+		}
+		return std::string(reinterpret_cast<const char*>(out.Data()), out.Size());
+	};
+
+	for (std::uint32_t version : { 1u, 2u }) {
+		INFO("version " << version);
+		auto bytes = image(version);
+		auto loaded = LoadModule(reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size());
+		REQUIRE_FALSE(loaded.second.has_value());
+		auto& module = loaded.first;
+		REQUIRE(module.verified);
+		REQUIRE(module.functions.size() == 2);
+		REQUIRE(module.functions[0].max_stack == (version == 1 ? -1 : 3));
+		REQUIRE(module.functions[0].max_depth == 3);
+		REQUIRE(module.functions[1].max_depth == (version == 1 ? 2 : 3));
+
+		std::istringstream in;
+		std::ostringstream out;
+		VM vm(module, in, out);
+		REQUIRE_FALSE(vm.Run().has_value());
+		REQUIRE(out.str() == "42\n");
+	}
+
+	auto bytes = image(3);
+	REQUIRE(LoadModule(reinterpret_cast<const std::uint8_t*>(bytes.data()), bytes.size()).second.value().GetCode() == VMBadVersion);
+}
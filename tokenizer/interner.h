@@ -0,0 +1,94 @@
+#pragma once
+
+#include "arena/arena.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 标识符驻留表：每个不同的标识符在词法分析时分配一个从 0 开始的稠密 id，
+	// 之后的符号表都以 id 为键，不再比较字符串。
+	class StringInterner final {
+	private:
+		using int32_t = std::int32_t;
+		using uint32_t = std::uint32_t;
+	public:
+		StringInterner() : _arena(16 * 1024), _names(), _hashes(), _slots(64, -1) {}
+		StringInterner(StringInterner&&) = delete;
+		StringInterner(const StringInterner&) = delete;
+		StringInterner& operator=(StringInterner) = delete;
+
+		int32_t Intern(std::string_view s) {
+			auto h = hash(s);
+			auto mask = _slots.size() - 1;
+			for (auto i = h & mask;; i = (i + 1) & mask) {
+				auto id = _slots[i];
+				if (id < 0)
+					return insert(s, h, i);
+				if (_hashes[id] == h && _names[id] == s)
+					return id;
+			}
+		}
+
+		// 找不到时返回 -1，不会插入
+		int32_t Find(std::string_view s) const {
+			auto h = hash(s);
+			auto mask = _slots.size() - 1;
+			for (auto i = h & mask;; i = (i + 1) & mask) {
+				auto id = _slots[i];
+				if (id < 0)
+					return -1;
+				if (_hashes[id] == h && _names[id] == s)
+					return id;
+			}
+		}
+
+		std::string_view Lookup(int32_t id) const { return _names[id]; }
+		std::size_t Size() const { return _names.size(); }
+	private:
+		static uint32_t hash(std::string_view s) {
+			// FNV-1a
+			uint32_t h = 2166136261u;
+			for (auto ch : s) {
+				h ^= static_cast<unsigned char>(ch);
+				h *= 16777619u;
+			}
+			return h;
+		}
+
+		int32_t insert(std::string_view s, uint32_t h, std::size_t slot) {
+			auto p = static_cast<char*>(_arena.Allocate(s.size() + 1, 1));
+			std::memcpy(p, s.data(), s.size());
+			p[s.size()] = '\0';
+			int32_t id = static_cast<int32_t>(_names.size());
+			_names.emplace_back(p, s.size());
+			_hashes.push_back(h);
+			_slots[slot] = id;
+			// 装载因子超过 1/2 时扩容
+			if (_names.size() * 2 > _slots.size())
+				grow();
+			return id;
+		}
+
+		void grow() {
+			std::vector<int32_t> slots(_slots.size() * 2, -1);
+			auto mask = slots.size() - 1;
+			for (int32_t id = 0; id < (int32_t)_names.size(); id++) {
+				auto i = _hashes[id] & mask;
+				while (slots[i] >= 0)
+					i = (i + 1) & mask;
+				slots[i] = id;
+			}
+			_slots.swap(slots);
+		}
+	private:
+		// 字符串本体存放在 arena 中，_names 中的 string_view 一直有效
+		Arena _arena;
+		std::vector<std::string_view> _names;
+		std::vector<uint32_t> _hashes;
+		std::vector<int32_t> _slots;
+	};
+}
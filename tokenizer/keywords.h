@@ -0,0 +1,90 @@
+#pragma once
+
+#include "tokenizer/token.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace miniplc0 {
+
+	// 关键字的完美散列：只看首字符、尾字符和长度，散列种子在编译期搜索，
+	// 保证 19 个关键字落在 64 个槽中互不冲突。识别一个标识符只需一次散列和一次比较。
+	namespace keywords {
+
+		typedef struct {
+			std::string_view name;
+			TokenType type;
+		}Keyword;
+
+		inline constexpr Keyword kKeywords[] = {
+			{ "const", TokenType::CONST }, { "void", TokenType::VOID }, { "int", TokenType::INT },
+			{ "char", TokenType::CHAR }, { "double", TokenType::DOUBLE }, { "struct", TokenType::STRUCT },
+			{ "if", TokenType::IF }, { "else", TokenType::ELSE }, { "switch", TokenType::SWITCH },
+			{ "case", TokenType::CASE }, { "default", TokenType::DEFAULT }, { "while", TokenType::WHILE },
+			{ "for", TokenType::FOR }, { "do", TokenType::DO }, { "return", TokenType::RETURN },
+			{ "break", TokenType::BREAK }, { "continue", TokenType::CONTINUE }, { "print", TokenType::PRINT },
+			{ "scan", TokenType::SCAN },
+		};
+
+		inline constexpr std::size_t kSlotBits = 6;
+		inline constexpr std::size_t kSlots = std::size_t(1) << kSlotBits;
+		inline constexpr std::size_t kMaxLength = 8;
+
+		// 调用者保证 s 非空
+		constexpr std::uint32_t hash(std::string_view s, std::uint32_t seed) {
+			std::uint32_t h = seed;
+			h = (h ^ static_cast<unsigned char>(s[0])) * 16777619u;
+			h = (h ^ static_cast<unsigned char>(s[s.size() - 1])) * 16777619u;
+			h = (h ^ static_cast<std::uint32_t>(s.size())) * 16777619u;
+			return h >> (32 - kSlotBits);
+		}
+
+		constexpr bool collisionFree(std::uint32_t seed) {
+			bool used[kSlots] = {};
+			for (auto& kw : kKeywords) {
+				auto slot = hash(kw.name, seed);
+				if (used[slot])
+					return false;
+				used[slot] = true;
+			}
+			return true;
+		}
+
+		constexpr std::uint32_t findSeed() {
+			for (std::uint32_t seed = 1; seed < 100000; seed++)
+				if (collisionFree(seed))
+					return seed;
+			return 0;
+		}
+
+		inline constexpr std::uint32_t kSeed = findSeed();
+		static_assert(kSeed != 0 && collisionFree(kSeed), "keyword hash must be collision-free");
+
+		// 槽位 -> 关键字下标，-1 表示空槽
+		constexpr std::array<std::int8_t, kSlots> makeSlots() {
+			std::array<std::int8_t, kSlots> t{};
+			for (auto& v : t)
+				v = -1;
+			for (std::size_t i = 0; i < sizeof(kKeywords) / sizeof(kKeywords[0]); i++)
+				t[hash(kKeywords[i].name, kSeed)] = static_cast<std::int8_t>(i);
+			return t;
+		}
+
+		inline constexpr std::array<std::int8_t, kSlots> kSlotTable = makeSlots();
+	}
+
+	// 关键字返回对应的 TokenType，否则返回 IDENTIFIER
+	constexpr TokenType LookupKeyword(std::string_view s) {
+		if (s.empty() || s.size() > keywords::kMaxLength)
+			return TokenType::IDENTIFIER;
+		auto i = keywords::kSlotTable[keywords::hash(s, keywords::kSeed)];
+		if (i < 0 || keywords::kKeywords[i].name != s)
+			return TokenType::IDENTIFIER;
+		return keywords::kKeywords[i].type;
+	}
+
+	static_assert(LookupKeyword("while") == TokenType::WHILE, "keyword lookup");
+	static_assert(LookupKeyword("whilex") == TokenType::IDENTIFIER, "keyword lookup");
+}
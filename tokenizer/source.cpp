@@ -0,0 +1,97 @@
+#include "tokenizer/source.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace miniplc0 {
+
+	SourceBuffer::~SourceBuffer() {
+		release();
+	}
+
+	bool SourceBuffer::Open(const std::string& path) {
+		release();
+#ifndef _WIN32
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0)
+			return false;
+		struct stat st;
+		if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+			auto size = static_cast<std::size_t>(st.st_size);
+			void* p = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED) {
+				::close(fd);
+				::madvise(p, size, MADV_SEQUENTIAL);
+				_map = p;
+				_map_size = size;
+				_data = static_cast<const char*>(p);
+				_size = size;
+				return true;
+			}
+		}
+		::close(fd);
+#endif
+		// 空文件、管道或者不支持 mmap 的平台：退化为一次性读入
+		std::ifstream ifs(path, std::ios::in | std::ios::binary);
+		if (!ifs)
+			return false;
+		Read(ifs);
+		return true;
+	}
+
+	void SourceBuffer::Read(std::istream& is) {
+		release();
+		char buffer[64 * 1024];
+		while (is.read(buffer, sizeof(buffer)) || is.gcount() > 0)
+			_storage.append(buffer, static_cast<std::size_t>(is.gcount()));
+		_data = _storage.data();
+		_size = _storage.size();
+	}
+
+	std::pair<std::uint64_t, std::uint64_t> SourceBuffer::PosOf(std::size_t offset) const {
+		if (!_indexed)
+			buildLineIndex();
+		if (offset > _size)
+			return std::make_pair<uint64_t, uint64_t>(_line_starts.size(), 0);
+		auto it = std::upper_bound(_line_starts.begin(), _line_starts.end(), static_cast<uint32_t>(offset));
+		uint64_t line = static_cast<uint64_t>(it - _line_starts.begin()) - 1;
+		return std::make_pair<uint64_t, uint64_t>(std::move(line), offset - _line_starts[line]);
+	}
+
+	void SourceBuffer::release() {
+#ifndef _WIN32
+		if (_map != nullptr)
+			::munmap(_map, _map_size);
+#endif
+		_map = nullptr;
+		_map_size = 0;
+		_storage.clear();
+		_data = "";
+		_size = 0;
+		_line_starts.clear();
+		_indexed = false;
+	}
+
+	void SourceBuffer::buildLineIndex() const {
+		_line_starts.clear();
+		_line_starts.push_back(0);
+		auto p = _data;
+		auto end = _data + _size;
+		while (p < end) {
+			auto nl = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)));
+			if (nl == nullptr)
+				break;
+			p = nl + 1;
+			_line_starts.push_back(static_cast<uint32_t>(p - _data));
+		}
+		_indexed = true;
+	}
+}
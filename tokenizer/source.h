@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 整个源文件的一块连续只读内存：能映射时直接 mmap，否则一次性读入。
+	// 词法分析只记录字节偏移，行列号在需要报错或输出位置时才由行首索引换算。
+	class SourceBuffer final {
+	private:
+		using uint64_t = std::uint64_t;
+		using uint32_t = std::uint32_t;
+	public:
+		SourceBuffer() : _data(""), _size(0), _storage(), _map(nullptr), _map_size(0), _line_starts(), _indexed(false) {}
+		explicit SourceBuffer(std::istream& is) : SourceBuffer() { Read(is); }
+		~SourceBuffer();
+		SourceBuffer(SourceBuffer&&) = delete;
+		SourceBuffer(const SourceBuffer&) = delete;
+		SourceBuffer& operator=(SourceBuffer) = delete;
+
+		// 映射（或读入）整个文件，打不开时返回 false
+		bool Open(const std::string& path);
+		// 把流中剩余的内容读入一块缓冲区
+		void Read(std::istream& is);
+
+		const char* Data() const { return _data; }
+		std::size_t Size() const { return _size; }
+
+		// 字节偏移 -> (行, 列)，均从 0 开始；超出末尾的偏移落在最后一行之后
+		std::pair<uint64_t, uint64_t> PosOf(std::size_t offset) const;
+	private:
+		void release();
+		void buildLineIndex() const;
+	private:
+		const char* _data;
+		std::size_t _size;
+		// 读入模式下的缓冲区
+		std::string _storage;
+		// 映射模式下的映射区
+		void* _map;
+		std::size_t _map_size;
+		// 每一行第一个字符的偏移，第一次换算位置时才建立
+		mutable std::vector<uint32_t> _line_starts;
+		mutable bool _indexed;
+	};
+}
@@ -2,13 +2,13 @@
 
 #include "error/error.h"
 
-#include <any>
-#include <string>
 #include <cstdint>
+#include <type_traits>
+#include <utility>
 
 namespace miniplc0 {
 
-	enum TokenType {
+	enum TokenType : std::uint8_t {
 		NULL_TOKEN,
 		UNSIGNED_INTEGER,
 		IDENTIFIER,
@@ -67,63 +67,39 @@ namespace miniplc0 {
 		DOUHAO
 	};
 
+	// 词法单元：类型标签 + 一个 32 位负载 + 源码中的字节区间 [start, end)，可以按位拷贝。
+	// 负载的含义取决于类型：UNSIGNED_INTEGER 是数值，IDENTIFIER 是驻留 id，
+	// 单字符符号是该字符，关键字等其余类型为 0。
+	// 行列号不随 Token 保存，需要时用 SourceBuffer::PosOf 换算。
 	class Token final {
 	private:
 		using uint64_t = std::uint64_t;
+		using uint32_t = std::uint32_t;
 		using int32_t = std::int32_t;
 	public:
-
-		friend void swap(Token& lhs, Token& rhs);
-
-	public:
-
-		Token(TokenType type, std::any value, uint64_t start_line, uint64_t start_column, uint64_t end_line, uint64_t end_column)
-			: _type(type), _value(std::move(value)), _start_pos(start_line, start_column), _end_pos(end_line, end_column) {}
-		Token(TokenType type, std::any value, std::pair<uint64_t, uint64_t> start, std::pair<uint64_t, uint64_t> end)
-			: Token(type, value, start.first, start.second, end.first, end.second) {}
-		Token(const Token& t) { _type = t._type;  _value = t._value; _start_pos = t._start_pos; _end_pos = t._end_pos; }
-		Token(Token&& t) : Token(TokenType::NULL_TOKEN, nullptr, 0, 0, 0, 0) { swap(*this, t); }
-		Token& operator=(Token t) { swap(*this, t); return *this; }
+		Token(TokenType type, int32_t value, uint64_t start, uint64_t end)
+			: _type(type), _value(value), _start((uint32_t)start), _end((uint32_t)end) {}
+		Token() : Token(TokenType::NULL_TOKEN, 0, 0, 0) {}
+		Token(const Token& t) = default;
+		Token& operator=(const Token& t) = default;
 		bool operator==(const Token& rhs) const {
 			return _type == rhs._type
-				&& GetValueString() == rhs.GetValueString()
-				&& _start_pos == rhs._start_pos
-				&& _end_pos == rhs._end_pos;
+				&& _value == rhs._value
+				&& _start == rhs._start
+				&& _end == rhs._end;
 		}
 
 		TokenType GetType() const { return _type; };
-		std::any GetValue() const { return _value; };
-		std::pair<uint64_t, uint64_t> GetStartPos() const { return _start_pos; }
-		std::pair<uint64_t, uint64_t> GetEndPos() const { return _end_pos; }
-		std::string GetValueString() const {
-			try {
-				return std::any_cast<std::string>(_value);
-			}
-			catch (const std::bad_any_cast&) {}
-			try {
-				return std::string(1, std::any_cast<char>(_value));
-			}
-			catch (const std::bad_any_cast&) {}
-			try {
-				return std::to_string(std::any_cast<int32_t>(_value));
-			}
-			catch (const std::bad_any_cast&) {
-				DieAndPrint("No suitable cast for token value.");
-			}
-			return "Invalid";
-		}
+		int32_t GetValue() const { return _value; };
+		// 标识符的驻留 id
+		int32_t GetId() const { return _value; }
+		uint64_t GetStart() const { return _start; }
+		uint64_t GetEnd() const { return _end; }
 	private:
 		TokenType _type;
-		std::any _value;
-		std::pair<uint64_t, uint64_t> _start_pos;
-		std::pair<uint64_t, uint64_t> _end_pos;
+		int32_t _value;
+		uint32_t _start;
+		uint32_t _end;
 	};
-
-	inline void swap(Token& lhs, Token& rhs) {
-		using std::swap;
-		swap(lhs._type, rhs._type);
-		swap(lhs._value, rhs._value);
-		swap(lhs._start_pos, rhs._start_pos);
-		swap(lhs._end_pos, rhs._end_pos);
-	}
+	static_assert(std::is_trivially_copyable<Token>::value, "Token should be trivially copyable");
 }
\ No newline at end of file
@@ -1,24 +1,29 @@
 #include "tokenizer/tokenizer.h"
+#include "tokenizer/keywords.h"
 
-#include <cctype>
-#include <sstream>
+#include <array>
+#include <climits>
+#include <cstring>
+#include <string_view>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MINIPLC0_SSE2 1
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 
 namespace miniplc0 {
 
 	std::pair<std::optional<Token>, std::optional<CompilationError>> Tokenizer::NextToken() {
 		if (!_initialized)
 			readAll();
-		if (_rdr.bad())
+		if (_rdr != nullptr && _rdr->bad())
 			return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(0, 0, ErrorCode::ErrStreamError));
 		if (isEOF())
 			return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(0, 0, ErrorCode::ErrEOF));
-		auto p = nextToken();
-		if (p.second.has_value())
-			return std::make_pair(p.first, p.second);
-		auto err = checkToken(p.first.value());
-		if (err.has_value())
-			return std::make_pair(p.first, err.value());
-		return std::make_pair(p.first, std::optional<CompilationError>());
+		return nextToken();
 	}
 
 	std::pair<std::vector<Token>, std::optional<CompilationError>> Tokenizer::AllTokens() {
@@ -35,412 +40,240 @@ namespace miniplc0 {
 		}
 	}
 
-	// 注意：这里的返回值中 Token 和 CompilationError 只能返回一个，不能同时返回。
-	std::pair<std::optional<Token>, std::optional<CompilationError>> Tokenizer::nextToken() {
-		std::stringstream ss;
-		std::pair<std::optional<Token>, std::optional<CompilationError>> result;
-		std::pair<int64_t, int64_t> pos;
-		DFAState current_state = DFAState::INITIAL_STATE;
-		while (true) {
-			auto current_char = nextChar();
-			switch (current_state) {
-
-			case INITIAL_STATE: {
-				if (!current_char.has_value())
-					return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(0, 0, ErrEOF));
-
-				auto ch = current_char.value();
-				auto invalid = false;
-
-				// 使用了自己封装的判断字符类型的函数，定义于 tokenizer/utils.hpp
-				if (miniplc0::isspace(ch)) // 读到的字符是空白字符（空格、换行、制表符等）
-					current_state = DFAState::INITIAL_STATE; // 保留当前状态为初始状态，此处直接break也是可以的
-				else if (!miniplc0::isprint(ch)) // control codes and backspace
-					invalid = true;
-				else if (miniplc0::isdigit(ch)) // 读到的字符是数字
-					current_state = DFAState::UNSIGNED_INTEGER_STATE; // 切换到无符号整数的状态
-				else if (miniplc0::isalpha(ch)) // 读到的字符是英文字母
-					current_state = DFAState::IDENTIFIER_STATE; // 切换到标识符的状态
-				else {
-					switch (ch) {
-					case '=': // 如果读到的字符是`=`，则切换到等于号的状态
-						current_state = DFAState::DY_STATE;
-						break;
-					case '-':
-						current_state = DFAState::MINUS_STATE;
-						break;
-						// 请填空：切换到减号的状态
-					case '+':
-						current_state = DFAState::PLUS_STATE;
-						break;
-					case '*':
-						current_state = DFAState::STAR_STATE;
-						break;
-					case '/':
-						current_state = DFAState::DIV_STATE;
-						break;
-					case '>':
-						current_state = DFAState::GREATER_STATE;
-						break;
-					case '<':
-						current_state = DFAState::LESS_STATE;
-						break;
-					case '!':
-						current_state = DFAState::GT_STATE;
-						break;
-					case ':':
-						current_state = DFAState::COLON_STATE;
-						break;
-					case ';':
-						current_state = DFAState::SEMICOLON_STATE;
-						break;
-					case '(':
-						current_state = DFAState::ZKH_STATE;
-						break;
-					case ')':
-						current_state = DFAState::YKH_STATE;
-						break;
-					case '[':
-						current_state = DFAState::ZZKH_STATE;
-						break;
-					case ']':
-						current_state = DFAState::YZKH_STATE;
-					case '{':
-						current_state = DFAState::ZDKH_STATE;
-						break;
-					case '}':
-						current_state = DFAState::YDKH_STATE;
-						break;
-					case ',':
-						current_state = DFAState::DH_STATE;
-						break;
-					default:
-						invalid = true;
-						break;
-					}
-				}
-				if (current_state != DFAState::INITIAL_STATE)
-					pos = previousPos(); // 记录该字符的的位置为token的开始位置
-				if (invalid) {
-					unreadLast();
-					return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(pos, ErrorCode::ErrInvalidInput));
-				}
-				if (current_state != DFAState::INITIAL_STATE) // ignore white spaces
-					ss << ch; // 存储读到的字符
-				break;
-			}
-			case UNSIGNED_INTEGER_STATE: {
-				if (!current_char.has_value()) {
-					std::string sss = ss.str();
-					int n = atoi(sss.c_str());
-					return std::make_pair(std::make_optional<Token>(TokenType::UNSIGNED_INTEGER, n, pos, currentPos()), std::optional<CompilationError>());
+	namespace {
 
-				}
-				auto ch = current_char.value();
+		// 单字符就能确定的符号，其余为 NULL_TOKEN
+		constexpr std::array<TokenType, 256> makeSymbolTable() {
+			std::array<TokenType, 256> t{};
+			t['+'] = TokenType::PLUS;
+			t['-'] = TokenType::MINUS;
+			t['*'] = TokenType::STAR;
+			t[';'] = TokenType::SEMICOLON;
+			t[':'] = TokenType::COLON;
+			t['('] = TokenType::ZKH;
+			t[')'] = TokenType::YKH;
+			t['['] = TokenType::ZZKH;
+			t[']'] = TokenType::YZKH;
+			t['{'] = TokenType::ZDKH;
+			t['}'] = TokenType::YDKH;
+			t[','] = TokenType::DOUHAO;
+			return t;
+		}
 
-				if (miniplc0::isdigit(ch))
-					ss << ch;
-				else if (ch == 'x' || ch == 'X') {
-					ss << ch;
-					current_state = DFAState::HEX_STATE;
-				}
-				else if (miniplc0::isalpha(ch) && (ch != 'x' && ch != 'X')) {
-					ss << ch;
-					current_state = DFAState::IDENTIFIER_STATE;
-				}
-				else {
-					unreadLast();
-					std::string sss = ss.str();
-					int n = atoi(sss.c_str());
-					return std::make_pair(std::make_optional<Token>(TokenType::UNSIGNED_INTEGER, n, pos, currentPos()), std::optional<CompilationError>());
-				}
-				if (current_state == DFAState::IDENTIFIER_STATE)
-					return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(0, 0, ErrEOF));
-				break;
-			}
-			case HEX_STATE: {
-				if (!current_char.has_value()) {
-					std::string sss = ss.str();
-					int n = atoi(sss.c_str());
-					return std::make_pair(std::make_optional<Token>(TokenType::UNSIGNED_INTEGER, n, pos, currentPos()), std::optional<CompilationError>());
+		constexpr std::array<TokenType, 256> kSymbols = makeSymbolTable();
 
-				}
-				auto ch = current_char.value();
+#ifdef MINIPLC0_SSE2
+		inline int countTrailingZeros(unsigned mask) {
+#if defined(_MSC_VER)
+			unsigned long i;
+			_BitScanForward(&i, mask);
+			return (int)i;
+#else
+			return __builtin_ctz(mask);
+#endif
+		}
 
-				if (miniplc0::isdigit(ch))
-					ss << ch;
-				else if (miniplc0::isalpha(ch)) {
-					ss << ch;
-				}
-				else {
-					unreadLast();
-					std::string sss = ss.str();
-					char* meme;
-					long long me = strtol(sss.c_str(), &meme, 16);
-					int n = (int)me;
-					return std::make_pair(std::make_optional<Token>(TokenType::UNSIGNED_INTEGER, n, pos, currentPos()), std::optional<CompilationError>());
-				}
-				if (current_state == DFAState::IDENTIFIER_STATE)
-					return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(0, 0, ErrEOF));
-				break;
-			}
-			case IDENTIFIER_STATE: {
-				auto gg = false;
-				if (!current_char.has_value())
-					gg = true;
-				auto ch = current_char.value();
-				if (miniplc0::isdigit(ch) || miniplc0::isalpha(ch))
-					ss << ch;
-				else {
-					unreadLast();
-					gg = true;
-				}
-				if (gg) {
-					if (ss.str().compare("const") == 0) {
-						return std::make_pair(std::make_optional<Token>(TokenType::CONST, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					}
-					else if (ss.str().compare("void") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::VOID, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("int") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::INT, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("char") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::CHAR, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("double") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::DOUBLE, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("struct") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::STRUCT, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("if") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::IF, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("else") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::ELSE, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("switch") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::SWITCH, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("case") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::CASE, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("default") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::DEFAULT, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("while") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::WHILE, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("for") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::FOR, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("do") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::DO, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("return") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::RETURN, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("break") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::BREAK, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("continue") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::CONTINUE, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("print") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::PRINT, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else if (ss.str().compare("scan") == 0)
-						return std::make_pair(std::make_optional<Token>(TokenType::SCAN, ss.str(), pos, currentPos()),
-							std::optional<CompilationError>());
-					else return  std::make_pair(std::make_optional<Token>(TokenType::IDENTIFIER, ss.str(), pos, currentPos()), std::optional<CompilationError>());
-				}
-				break;
-			}
-			case PLUS_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::PLUS, '+', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case MINUS_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::MINUS, '-', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case STAR_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::STAR, '*', pos, currentPos()), std::optional<CompilationError>());
+		// 16 字节中每个字节是否在 [lo, hi] 内（只用于 ASCII 区间，>= 0x80 的字节视为负数而落在区间外）
+		inline __m128i inRange(__m128i v, char lo, char hi) {
+			return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+		}
+#endif
 
+		// 返回从 p 开始的 [0-9] 串的结尾
+		std::size_t scanDigits(const char* data, std::size_t p, std::size_t size) {
+#ifdef MINIPLC0_SSE2
+			while (p + 16 <= size) {
+				auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + p));
+				auto mask = (unsigned)_mm_movemask_epi8(inRange(v, '0', '9'));
+				if (mask != 0xffff)
+					return p + countTrailingZeros(~mask);
+				p += 16;
 			}
-			case DIV_STATE: {
-				auto ch = current_char.value();
-				if (ch != '*' && ch != '/') {
-					unreadLast(); 
-					return std::make_pair(std::make_optional<Token>(TokenType::_DIV, '/', pos, currentPos()), std::optional<CompilationError>());
-				}
-				if (ch == '*') {
-					auto nxt = nextChar();
-					while (true) {
-						if (nxt.value() == '*') {
-							auto nt = nextChar();
-							if (nt.value() == '/')
-								break;
-						}
-						nxt = nextChar();
-					}
-				}
-				else {
-					auto nxt = nextChar();
-					while (true) {
-						if (nxt.value() == 0x0a|| nxt.value() == 0x0d) 
-								break;
-						nxt = nextChar();
-					}
-				}
-			}
-			case DY_STATE: {
-				auto ch = current_char.value();
-				if (ch == '=')
-					return std::make_pair(std::make_optional<Token>(TokenType::EQ, "==", pos, currentPos()), std::optional<CompilationError>());
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::FZ, '=', pos, currentPos()), std::optional<CompilationError>());
+#endif
+			while (p < size && miniplc0::isdigit(data[p]))
+				p++;
+			return p;
+		}
 
+		// 返回从 p 开始的 [A-Za-z0-9] 串的结尾
+		std::size_t scanAlnum(const char* data, std::size_t p, std::size_t size) {
+#ifdef MINIPLC0_SSE2
+			while (p + 16 <= size) {
+				auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + p));
+				// 或上 0x20 把大写字母折到小写
+				auto alpha = inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+				auto mask = (unsigned)_mm_movemask_epi8(_mm_or_si128(alpha, inRange(v, '0', '9')));
+				if (mask != 0xffff)
+					return p + countTrailingZeros(~mask);
+				p += 16;
 			}
-			case LESS_STATE: {
-				// 请填空：回退，并返回减号token
-				auto ch = current_char.value();
-				if (ch == '=')
-					return std::make_pair(std::make_optional<Token>(TokenType::LOE, "<=", pos, currentPos()), std::optional<CompilationError>());
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::LESS, '<', pos, currentPos()), std::optional<CompilationError>());
+#endif
+			while (p < size && miniplc0::isalnum(data[p]))
+				p++;
+			return p;
+		}
 
-			}
-			case GREATER_STATE: {
-				// 请填空：回退，并返回减号token
-				auto ch = current_char.value();
-				if (ch == '=')
-					return std::make_pair(std::make_optional<Token>(TokenType::GOE, ">=", pos, currentPos()), std::optional<CompilationError>());
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::GREATER, '>', pos, currentPos()), std::optional<CompilationError>());
+		int hexValue(char ch) {
+			if (miniplc0::isdigit(ch))
+				return ch - '0';
+			return (ch | 0x20) - 'a' + 10;
+		}
+	}
 
-			}
-			case GT_STATE: {
-				// 请填空：回退，并返回减号token
-				auto ch = current_char.value();
-				if (ch == '=')
-					return std::make_pair(std::make_optional<Token>(TokenType::NE, "!=", pos, currentPos()), std::optional<CompilationError>());
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(pos, ErrorCode::ErrInvalidInput));
+	// 注意：这里的返回值中 Token 和 CompilationError 只能返回一个，不能同时返回。
+	Tokenizer::Result Tokenizer::nextToken() {
+		auto err = skipSpaceAndComments();
+		if (err.has_value())
+			return std::make_pair(std::optional<Token>(), err);
+		if (isEOF())
+			return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(0, 0, ErrEOF));
+		auto ch = _data[_ptr];
+		if (miniplc0::isdigit(ch))
+			return lexNumber();
+		if (miniplc0::isalpha(ch))
+			return lexIdentifier();
+		return lexSymbol();
+	}
 
+	std::optional<CompilationError> Tokenizer::skipSpaceAndComments() {
+		while (_ptr < _size) {
+			auto ch = _data[_ptr];
+			if (miniplc0::isspace(ch)) {
+				_ptr++;
+				continue;
 			}
-			case SEMICOLON_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::SEMICOLON, ';', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case COLON_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::COLON, ':', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case ZKH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::ZKH, '(', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case YKH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::YKH, ')', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case ZZKH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::ZZKH, '[', pos, currentPos()), std::optional<CompilationError>());
+			if (ch != '/' || _ptr + 1 >= _size)
+				return {};
+			auto next = _data[_ptr + 1];
+			if (next == '/') {
+				// 行注释到 '\n' 或 '\r' 为止，换行符本身留给上面的空白处理
+				_ptr += 2;
+				while (_ptr < _size && _data[_ptr] != '\n' && _data[_ptr] != '\r')
+					_ptr++;
 			}
-			case YZKH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::YZKH, ']', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case ZDKH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::ZDKH, '{', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case YDKH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::YDKH, '}', pos, currentPos()), std::optional<CompilationError>());
-			}
-			case DH_STATE: {
-				unreadLast(); // Yes, we unread last char even if it's an EOF.
-				return std::make_pair(std::make_optional<Token>(TokenType::DOUHAO, ',', pos, currentPos()), std::optional<CompilationError>());
-			}
-
-			default:
-				DieAndPrint("unhandled state.");
-				break;
+			else if (next == '*') {
+				auto start = _ptr;
+				_ptr += 2;
+				while (true) {
+					auto star = static_cast<const char*>(std::memchr(_data + _ptr, '*', _size - _ptr));
+					if (star == nullptr || star + 1 >= _data + _size) {
+						_ptr = _size;
+						return std::make_optional<CompilationError>(PosOf(start), ErrorCode::ErrInvalidInput);
+					}
+					_ptr = static_cast<std::size_t>(star - _data) + 1;
+					if (_data[_ptr] == '/') {
+						_ptr++;
+						break;
+					}
+				}
 			}
-			// ddd
+			else
+				return {};
 		}
-		// 预料之外的状态，如果执行到了这里，说明程序异常
-
-		return std::make_pair(std::optional<Token>(), std::optional<CompilationError>());
+		return {};
 	}
 
-	std::optional<CompilationError> Tokenizer::checkToken(const Token& t) {
-		switch (t.GetType()) {
-		case IDENTIFIER: {
-			auto val = t.GetValueString();
-			if (miniplc0::isdigit(val[0]))
-				return std::make_optional<CompilationError>(t.GetStartPos().first, t.GetStartPos().second, ErrorCode::ErrInvalidIdentifier);
-			break;
+	Tokenizer::Result Tokenizer::lexNumber() {
+		auto start = _ptr;
+		_ptr = scanDigits(_data, _ptr, _size);
+		if (_ptr < _size && (_data[_ptr] == 'x' || _data[_ptr] == 'X')) {
+			// 十六进制：吃掉后面所有的字母数字，按 strtol(..., 16) 的规则取值
+			_ptr = scanAlnum(_data, _ptr, _size);
+			auto p = start;
+			if (_data[p] == '0' && p + 2 < _ptr && miniplc0::isxdigit(_data[p + 2]))
+				p += 2;
+			long long n = 0;
+			for (; p < _ptr && miniplc0::isxdigit(_data[p]); p++)
+				n = n > (LLONG_MAX >> 4) ? LLONG_MAX : n * 16 + hexValue(_data[p]);
+			if (n > INT_MAX)
+				return makeError(ErrorCode::ErrIntegerOverflow, start);
+			return makeToken(TokenType::UNSIGNED_INTEGER, (int32_t)n, start);
 		}
-		default:
-			break;
+		if (_ptr < _size && miniplc0::isalpha(_data[_ptr])) {
+			// 以数字开头的标识符
+			_ptr = scanAlnum(_data, _ptr, _size);
+			return makeError(ErrorCode::ErrInvalidIdentifier, start);
 		}
-		return {};
+		// 放不进 int 的字面量报错，不再像 atoi 那样截断
+		long long n = 0;
+		for (auto p = start; p < _ptr; p++)
+			n = n > (LLONG_MAX - 9) / 10 ? LLONG_MAX : n * 10 + (_data[p] - '0');
+		if (n > INT_MAX)
+			return makeError(ErrorCode::ErrIntegerOverflow, start);
+		return makeToken(TokenType::UNSIGNED_INTEGER, (int32_t)n, start);
 	}
 
-	void Tokenizer::readAll() {
-		if (_initialized)
-			return;
-		for (std::string tp; std::getline(_rdr, tp);)
-			_lines_buffer.emplace_back(std::move(tp + "\n"));
-		_initialized = true;
-		_ptr = std::make_pair<int64_t, int64_t>(0, 0);
-		return;
+	Tokenizer::Result Tokenizer::lexIdentifier() {
+		auto start = _ptr;
+		_ptr = scanAlnum(_data, _ptr, _size);
+		std::string_view text(_data + start, _ptr - start);
+		auto type = LookupKeyword(text);
+		if (type != TokenType::IDENTIFIER)
+			return makeToken(type, 0, start);
+		return makeToken(TokenType::IDENTIFIER, _interner.Intern(text), start);
 	}
 
-	// Note: We allow this function to return a postion which is out of bound according to the design like std::vector::end().
-	std::pair<uint64_t, uint64_t> Tokenizer::nextPos() {
-		if (_ptr.first >= _lines_buffer.size())
-			DieAndPrint("advance after EOF");
-		if (_ptr.second == _lines_buffer[_ptr.first].size() - 1)
-			return std::make_pair(_ptr.first + 1, 0);
-		else
-			return std::make_pair(_ptr.first, _ptr.second + 1);
+	Tokenizer::Result Tokenizer::lexSymbol() {
+		auto start = _ptr;
+		auto ch = _data[_ptr++];
+		auto type = kSymbols[static_cast<unsigned char>(ch)];
+		if (type != TokenType::NULL_TOKEN)
+			return makeToken(type, ch, start);
+		auto follows = [this](char c) {
+			if (_ptr < _size && _data[_ptr] == c) {
+				_ptr++;
+				return true;
+			}
+			return false;
+		};
+		switch (ch) {
+		case '/':
+			return makeToken(TokenType::_DIV, '/', start);
+		case '=':
+			return follows('=') ? makeToken(TokenType::EQ, 0, start) : makeToken(TokenType::FZ, '=', start);
+		case '<':
+			return follows('=') ? makeToken(TokenType::LOE, 0, start) : makeToken(TokenType::LESS, '<', start);
+		case '>':
+			return follows('=') ? makeToken(TokenType::GOE, 0, start) : makeToken(TokenType::GREATER, '>', start);
+		case '!':
+			if (follows('='))
+				return makeToken(TokenType::NE, 0, start);
+			return makeError(ErrorCode::ErrInvalidInput, start);
+		default:
+			// 控制字符、非 ASCII 字节以及不认识的符号
+			_ptr = start;
+			return makeError(ErrorCode::ErrInvalidInput, start);
+		}
 	}
 
-	std::pair<uint64_t, uint64_t> Tokenizer::currentPos() {
-		return _ptr;
+	Tokenizer::Result Tokenizer::makeToken(TokenType type, int32_t value, std::size_t start) {
+		return std::make_pair(std::make_optional<Token>(type, value, start, _ptr), std::optional<CompilationError>());
 	}
 
-	std::pair<uint64_t, uint64_t> Tokenizer::previousPos() {
-		if (_ptr.first == 0 && _ptr.second == 0)
-			DieAndPrint("previous position from beginning");
-		if (_ptr.second == 0)
-			return std::make_pair(_ptr.first - 1, _lines_buffer[_ptr.first - 1].size() - 1);
-		else
-			return std::make_pair(_ptr.first, _ptr.second - 1);
+	Tokenizer::Result Tokenizer::makeError(ErrorCode err, std::size_t offset) {
+		return std::make_pair(std::optional<Token>(), std::make_optional<CompilationError>(PosOf(offset), err));
 	}
 
-	std::optional<char> Tokenizer::nextChar() {
-		if (isEOF())
-			return {}; // EOF
-		auto result = _lines_buffer[_ptr.first][_ptr.second];
-		_ptr = nextPos();
-		return result;
+	void Tokenizer::readAll() {
+		if (_initialized)
+			return;
+		if (_src == nullptr) {
+			_owned = std::make_unique<SourceBuffer>(*_rdr);
+			_src = _owned.get();
+		}
+		_data = _src->Data();
+		_size = _src->Size();
+		_ptr = 0;
+		_initialized = true;
 	}
 
-	bool Tokenizer::isEOF() {
-		return _ptr.first >= _lines_buffer.size();
+	std::pair<std::uint64_t, std::uint64_t> Tokenizer::PosOf(uint64_t offset) {
+		if (!_initialized)
+			readAll();
+		return _src->PosOf(offset);
 	}
 
-	// Note: Is it evil to unread a buffer?
-	void Tokenizer::unreadLast() {
-		_ptr = previousPos();
+	bool Tokenizer::isEOF() {
+		return _ptr >= _size;
 	}
-}
\ No newline at end of file
+}
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "tokenizer/token.h"
+#include "tokenizer/interner.h"
+#include "tokenizer/source.h"
 #include "tokenizer/utils.hpp"
 #include "error/error.h"
 
@@ -17,36 +19,15 @@ namespace miniplc0 {
 	class Tokenizer final {
 	private:
 		using uint64_t = std::uint64_t;
-
-		// 状态机的所有状态
-		enum DFAState {
-			INITIAL_STATE,
-			UNSIGNED_INTEGER_STATE,
-			HEX_STATE,
-			PLUS_STATE,
-			MINUS_STATE,
-			DIV_STATE,
-			STAR_STATE,
-			DY_STATE,  // =
-			IDENTIFIER_STATE,
-			DH_STATE,
-			SEMICOLON_STATE,
-			COLON_STATE,
-			GT_STATE,
-			GREATER_STATE,
-			LESS_STATE,
-			ZKH_STATE,
-			YKH_STATE,
-			ZZKH_STATE,
-			YZKH_STATE,
-			ZDKH_STATE,
-			YDKH_STATE,
-			DZS_STATE,
-			ZS_STATE
-		};
+		using int32_t = std::int32_t;
+		using Result = std::pair<std::optional<Token>, std::optional<CompilationError>>;
 	public:
-		Tokenizer(std::istream& ifs)
-			: _rdr(ifs), _initialized(false), _ptr(0, 0), _lines_buffer() {}
+		// 第一次取 token 时把整个流读入一块缓冲区
+		Tokenizer(std::istream& ifs, StringInterner& interner)
+			: _rdr(&ifs), _interner(interner), _owned(), _src(nullptr), _initialized(false), _data(nullptr), _size(0), _ptr(0) {}
+		// 直接扫描调用者持有的（通常是 mmap 的）源码，不做任何拷贝
+		Tokenizer(const SourceBuffer& src, StringInterner& interner)
+			: _rdr(nullptr), _interner(interner), _owned(), _src(&src), _initialized(false), _data(nullptr), _size(0), _ptr(0) {}
 		Tokenizer(Tokenizer&& tkz) = delete;
 		Tokenizer(const Tokenizer&) = delete;
 		Tokenizer& operator=(const Tokenizer&) = delete;
@@ -55,27 +36,37 @@ namespace miniplc0 {
 		std::pair<std::optional<Token>, std::optional<CompilationError>> NextToken();
 		// 一次返回所有 token
 		std::pair<std::vector<Token>, std::optional<CompilationError>> AllTokens();
-	private:
-		// 检查 Token 的合法性
-		std::optional<CompilationError> checkToken(const Token&);
 
-		std::pair<std::optional<Token>, std::optional<CompilationError>> nextToken();
+		// 字节偏移 -> (行, 列)
+		std::pair<uint64_t, uint64_t> PosOf(uint64_t offset);
+		StringInterner& GetInterner() { return _interner; }
+	private:
+		Result nextToken();
+		// 以下扫描函数从 _ptr 开始，返回时 _ptr 指向 token 之后的第一个字符
+		Result lexNumber();
+		Result lexIdentifier();
+		Result lexSymbol();
+		// 成片跳过空白和注释，注释没有闭合时报错
+		std::optional<CompilationError> skipSpaceAndComments();
+		Result makeToken(TokenType type, int32_t value, std::size_t start);
+		Result makeError(ErrorCode err, std::size_t offset);
 
 		void readAll();
-		std::pair<uint64_t, uint64_t> nextPos();
-		std::pair<uint64_t, uint64_t> currentPos();
-		std::pair<uint64_t, uint64_t> previousPos();
-		std::optional<char> nextChar();
 		bool isEOF();
-		void unreadLast();
 	private:
-		std::istream& _rdr;
+		// 从流构造时才有
+		std::istream* _rdr;
+		// 标识符在这里驻留，Analyser 共享同一个表
+		StringInterner& _interner;
+		// 从流读入的缓冲区归 Tokenizer 所有
+		std::unique_ptr<SourceBuffer> _owned;
+		const SourceBuffer* _src;
 		// 如果没有初始化，那么就 readAll
 		bool _initialized;
-		// 指向下一个要读取的字符
-		std::pair<uint64_t, uint64_t> _ptr;
-		// 以行为基础的缓冲区
-		std::vector<std::string> _lines_buffer;
+		const char* _data;
+		std::size_t _size;
+		// 下一个要读取的字符的偏移
+		std::size_t _ptr;
 	};
 
 }
@@ -1,21 +1,59 @@
 #pragma once
 
-#include <cctype>
-
-// 我真是爱死 C++ 了.jpg
-// See https://en.cppreference.com/w/cpp/string/byte/isspace#Notes
-#define IS_FUNC(f) \
-	inline bool f(char ch){ \
-		return std::f(static_cast<unsigned char>(ch)); \
-	} \
-	using __let_this_macro_end_with_a_simicolon_##f = int
+#include <array>
+#include <cstdint>
 
 namespace miniplc0 {
-	IS_FUNC(isprint);
-	IS_FUNC(isspace);
-	IS_FUNC(isblank);
-	IS_FUNC(isalpha);
-	IS_FUNC(isupper);
-	IS_FUNC(islower);
-	IS_FUNC(isdigit);
-}
\ No newline at end of file
+
+	// 字符类别，可以按位组合。
+	// 只认 ASCII，与 "C" locale 下 <cctype> 的结果相同，但不经过 locale，也不会因为负的 char 出错。
+	enum CharClass : std::uint8_t {
+		CC_SPACE = 1 << 0,
+		CC_DIGIT = 1 << 1,
+		CC_ALPHA = 1 << 2,
+		CC_XDIGIT = 1 << 3,
+		CC_PRINT = 1 << 4,
+		CC_UPPER = 1 << 5,
+		CC_LOWER = 1 << 6,
+		CC_BLANK = 1 << 7
+	};
+
+	constexpr std::array<std::uint8_t, 256> makeCharClassTable() {
+		std::array<std::uint8_t, 256> t{};
+		for (int c = 0; c < 256; c++) {
+			std::uint8_t v = 0;
+			if (c == ' ' || (c >= '\t' && c <= '\r'))
+				v |= CC_SPACE;
+			if (c == ' ' || c == '\t')
+				v |= CC_BLANK;
+			if (c >= '0' && c <= '9')
+				v |= CC_DIGIT | CC_XDIGIT;
+			if (c >= 'A' && c <= 'Z')
+				v |= CC_ALPHA | CC_UPPER;
+			if (c >= 'a' && c <= 'z')
+				v |= CC_ALPHA | CC_LOWER;
+			if ((c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F'))
+				v |= CC_XDIGIT;
+			if (c >= 0x20 && c < 0x7f)
+				v |= CC_PRINT;
+			t[c] = v;
+		}
+		return t;
+	}
+
+	inline constexpr std::array<std::uint8_t, 256> kCharClass = makeCharClassTable();
+
+	constexpr bool hasClass(char ch, std::uint8_t cls) {
+		return (kCharClass[static_cast<unsigned char>(ch)] & cls) != 0;
+	}
+
+	constexpr bool isprint(char ch) { return hasClass(ch, CC_PRINT); }
+	constexpr bool isspace(char ch) { return hasClass(ch, CC_SPACE); }
+	constexpr bool isblank(char ch) { return hasClass(ch, CC_BLANK); }
+	constexpr bool isalpha(char ch) { return hasClass(ch, CC_ALPHA); }
+	constexpr bool isupper(char ch) { return hasClass(ch, CC_UPPER); }
+	constexpr bool islower(char ch) { return hasClass(ch, CC_LOWER); }
+	constexpr bool isdigit(char ch) { return hasClass(ch, CC_DIGIT); }
+	constexpr bool isxdigit(char ch) { return hasClass(ch, CC_XDIGIT); }
+	constexpr bool isalnum(char ch) { return hasClass(ch, CC_ALPHA | CC_DIGIT); }
+}
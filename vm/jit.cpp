@@ -0,0 +1,653 @@
+#include "vm/vm.h"
+#include "vm/jit.h"
+
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+
+// 只生成 x86-64 System V 的代码
+#if defined(MINIPLC0_VM_JIT) && !(defined(__x86_64__) && defined(__unix__))
+#undef MINIPLC0_VM_JIT
+#endif
+
+#ifdef MINIPLC0_VM_JIT
+#include <sys/mman.h>
+#endif
+
+namespace miniplc0 {
+
+	bool JitBuffer::Load(const std::vector<std::uint8_t>& code) {
+		release();
+#ifdef MINIPLC0_VM_JIT
+		auto p = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (p == MAP_FAILED)
+			return false;
+		std::memcpy(p, code.data(), code.size());
+		// 写完再去掉写权限，内存不会同时可写可执行
+		if (mprotect(p, code.size(), PROT_READ | PROT_EXEC) != 0) {
+			munmap(p, code.size());
+			return false;
+		}
+		_data = static_cast<std::uint8_t*>(p);
+		_size = code.size();
+		return true;
+#else
+		(void)code;
+		return false;
+#endif
+	}
+
+	void JitBuffer::release() {
+#ifdef MINIPLC0_VM_JIT
+		if (_data != nullptr)
+			munmap(_data, _size);
+#endif
+		_data = nullptr;
+		_size = 0;
+	}
+
+#ifdef MINIPLC0_VM_JIT
+	namespace {
+
+		enum Reg {
+			EAX, ECX, EDX, EBX, ESP, EBP, ESI, EDI,
+			R8, R9, R10, R11, R12, R13, R14, R15
+		};
+
+		// 条件跳转 0F 8x 的 x
+		enum Cond : std::uint8_t {
+			CC_O = 0x0, CC_E = 0x4, CC_NE = 0x5, CC_A = 0x7,
+			CC_L = 0xc, CC_GE = 0xd, CC_LE = 0xe, CC_G = 0xf
+		};
+
+		// 只实现用得到的编码。内存操作数一律是 [base + disp32]，base 不能是 rsp/r12
+		class Assembler final {
+		public:
+			std::vector<std::uint8_t> code;
+
+			std::size_t Pos() const { return code.size(); }
+			void Byte(std::uint8_t b) { code.push_back(b); }
+			void Bytes(std::initializer_list<std::uint8_t> bs) { code.insert(code.end(), bs); }
+			void U32(std::uint32_t v) {
+				for (int i = 0; i < 4; i++)
+					Byte((std::uint8_t)(v >> (8 * i)));
+			}
+			void U64(std::uint64_t v) {
+				U32((std::uint32_t)v);
+				U32((std::uint32_t)(v >> 32));
+			}
+
+			// opcode reg, [base + disp]
+			void Mem(std::uint8_t opcode, int reg, int base, std::int32_t disp, bool wide = false) {
+				rex(wide, reg, base);
+				Byte(opcode);
+				Byte((std::uint8_t)(0x80 | ((reg & 7) << 3) | (base & 7)));
+				U32((std::uint32_t)disp);
+			}
+			// opcode rm, reg 的寄存器形式
+			void RR(std::uint8_t opcode, int rm, int reg, bool wide = false) {
+				rex(wide, reg, rm);
+				Byte(opcode);
+				Byte((std::uint8_t)(0xc0 | ((reg & 7) << 3) | (rm & 7)));
+			}
+			void Load(int reg, int base, std::int32_t disp) { Mem(0x8b, reg, base, disp); }
+			void Store(int base, std::int32_t disp, int reg) { Mem(0x89, reg, base, disp); }
+			void StoreImm(int base, std::int32_t disp, std::int32_t imm) {
+				Mem(0xc7, 0, base, disp);
+				U32((std::uint32_t)imm);
+			}
+			void MovImm(int reg, std::int32_t imm) {
+				rex(false, 0, reg);
+				Byte((std::uint8_t)(0xb8 + (reg & 7)));
+				U32((std::uint32_t)imm);
+			}
+			// 调用 C++ 函数：mov rax, imm64; call rax。调用前后 rsp 的对齐由调用者保证
+			void CallAbs(std::uint64_t address) {
+				Bytes({ 0x48, 0xb8 });
+				U64(address);
+				Bytes({ 0xff, 0xd0 });
+			}
+			// 发出 32 位相对跳转，返回操作数的位置用于回填
+			std::size_t Jump() {
+				Byte(0xe9);
+				return hole();
+			}
+			std::size_t Jcc(Cond cc) {
+				Bytes({ 0x0f, (std::uint8_t)(0x80 | cc) });
+				return hole();
+			}
+			std::size_t Call() {
+				Byte(0xe8);
+				return hole();
+			}
+			void Patch(std::size_t at, std::size_t target) {
+				auto rel = (std::int32_t)((std::int64_t)target - (std::int64_t)(at + 4));
+				std::memcpy(code.data() + at, &rel, 4);
+			}
+		private:
+			void rex(bool wide, int reg, int rm) {
+				std::uint8_t r = (wide ? 8 : 0) | ((reg >> 3) << 2) | (rm >> 3);
+				if (r != 0)
+					Byte(0x40 | r);
+			}
+			std::size_t hole() {
+				auto at = Pos();
+				U32(0);
+				return at;
+			}
+		};
+
+		// 机器码通过这些函数做输入输出，按 C 调用约定调用
+		void jitPrintInt(JitContext* ctx, std::int32_t v) { *ctx->output << v; }
+		void jitPrintChar(JitContext* ctx, std::int32_t v) { *ctx->output << (char)v; }
+		void jitPrintLine(JitContext* ctx) { *ctx->output << '\n'; }
+		int jitScan(JitContext* ctx) { return (*ctx->input >> ctx->value) ? 1 : 0; }
+
+		template<typename F>
+		std::uint64_t address(F* f) { return (std::uint64_t)reinterpret_cast<std::uintptr_t>(f); }
+	}
+#endif
+
+	// 逐函数的模板 JIT。寄存器约定：
+	//   rbx 栈底，r13 当前帧的 bp，r14 栈的末尾，r15 JitContext，r12 还能进入的帧数，
+	//   eax 缓存栈顶（只在基本块内部），ecx/edx 临时。
+	// 每条指令执行前的栈深度在编译时算出，操作数栈的每个槽都是 [r13 + 4 * 深度]，
+	// 运行时不再维护 sp。深度算不出来（分支汇合处不一致、用到运行时地址的 loada/iload/istore、
+	// 调用了不能编译的函数）的函数整个留给解释器。
+	// 运行时错误的检查和解释器相同，操作数栈溢出例外：在入口按最大深度检查一次，报在函数的第一条指令。
+	class JitCompiler final {
+	private:
+		using int32_t = std::int32_t;
+		using size_t = std::size_t;
+		using Op = VM::Op;
+	public:
+		JitCompiler(VM& vm, int32_t globals) : _vm(vm), _globals(globals), _n((int32_t)vm._module.functions.size()),
+			_ok(_n, 1), _returns(_n, 0), _depth(_n), _max(_n, 0) {}
+
+		void Compile();
+	private:
+		bool analyse(int32_t fn);
+#ifdef MINIPLC0_VM_JIT
+		void emitTrampoline();
+		void emitFunction(int32_t fn);
+		void emitOp(int32_t fn, size_t i);
+		// 栈顶缓存：_cached 时深度 _d 的最上面一个槽在 eax 里而不在内存里
+		void flush();
+		void top(int reg);
+		// 把栈顶两个值弹到 eax（左）和 ecx（右）
+		void pop2();
+		void push();
+		// at 处的跳转改为跳到函数末尾的陷入桩
+		void trap(size_t at, VMErrorCode err, int32_t pc);
+		void callHelper(std::uint64_t address);
+		static std::int32_t slot(int32_t i) { return 4 * i; }
+#endif
+	private:
+		VM& _vm;
+		int32_t _globals;
+		int32_t _n;
+		std::vector<char> _ok;
+		// 0 只用 ret 返回，1 只用 iret，-1 两种都有
+		std::vector<int> _returns;
+		// 每条预解码指令执行前的深度（相对 bp），-1 为不可达
+		std::vector<std::vector<int32_t>> _depth;
+		std::vector<int32_t> _max;
+#ifdef MINIPLC0_VM_JIT
+		Assembler _as;
+		size_t _trap_common = 0;
+		std::vector<size_t> _entries;
+		std::vector<std::pair<size_t, int32_t>> _calls;
+		// 当前函数内的状态
+		int32_t _d = 0;
+		bool _cached = false;
+		std::vector<size_t> _labels;
+		std::vector<std::pair<size_t, size_t>> _jumps;
+		typedef struct {
+			size_t at;
+			VMErrorCode err;
+			int32_t pc;
+		}TrapSite;
+		std::vector<TrapSite> _traps;
+#endif
+	};
+
+	void JitCompiler::Compile() {
+		for (int32_t f = 0; f < _n; f++) {
+			bool ret = false, iret = false;
+			for (auto& d : _vm.compiled(f).code) {
+				ret = ret || d.op == VM::OP_RET;
+				iret = iret || d.op == VM::OP_IRET;
+			}
+			_returns[f] = ret && iret ? -1 : (iret ? 1 : 0);
+		}
+		// 调用了不能编译的函数的函数也不能编译，重复到不再变化
+		for (bool changed = true; changed;) {
+			changed = false;
+			for (int32_t f = 0; f < _n; f++)
+				if (_ok[f] && !analyse(f)) {
+					_ok[f] = 0;
+					changed = true;
+				}
+		}
+#ifdef MINIPLC0_VM_JIT
+		bool any = false;
+		for (int32_t f = 0; f < _n; f++)
+			any = any || _ok[f];
+		if (!any)
+			return;
+		emitTrampoline();
+		_entries.assign(_n, 0);
+		for (int32_t f = 0; f < _n; f++)
+			if (_ok[f])
+				emitFunction(f);
+		for (auto& c : _calls)
+			_as.Patch(c.first, _entries[c.second]);
+		if (!_vm._jit_code.Load(_as.code))
+			return;
+		_vm._jit_context.limit = _vm._stack.data() + _vm._stack.size();
+		for (int32_t f = 0; f < _n; f++)
+			if (_ok[f])
+				_vm.compiled(f).native = _vm._jit_code.Data() + _entries[f];
+#endif
+	}
+
+	bool JitCompiler::analyse(int32_t fn) {
+		auto& c = _vm.compiled(fn);
+		auto& depth = _depth[fn];
+		depth.assign(c.code.size(), -1);
+		int32_t max = c.num_par;
+		std::vector<size_t> work;
+		auto reach = [&](size_t i, int32_t d) {
+			if (depth[i] < 0) {
+				depth[i] = d;
+				work.push_back(i);
+				return true;
+			}
+			return depth[i] == d;
+		};
+		reach(0, c.num_par);
+		while (!work.empty()) {
+			auto i = work.back();
+			work.pop_back();
+			auto& d = c.code[i];
+			auto in = depth[i];
+			int32_t pops = 0, pushes = 0, target = -1;
+			bool next = true;
+			switch (d.op) {
+			case VM::OP_NOP:
+			case VM::OP_PRINTL:
+				break;
+			case VM::OP_PUSH:
+			case VM::OP_ISCAN:
+				pushes = 1;
+				break;
+			case VM::OP_POP:
+			case VM::OP_IPRINT:
+			case VM::OP_CPRINT:
+				pops = 1;
+				break;
+			case VM::OP_IADD:
+			case VM::OP_ISUB:
+			case VM::OP_IMUL:
+			case VM::OP_IDIV:
+			case VM::OP_ICMP:
+				pops = 2;
+				pushes = 1;
+				break;
+			case VM::OP_INEG:
+			case VM::OP_ADD_IMM:
+			case VM::OP_SUB_IMM:
+				pops = 1;
+				pushes = 1;
+				break;
+			case VM::OP_LOAD_LOCAL:
+				if (d.x < 0 || d.x >= in)
+					return false;
+				pushes = 1;
+				break;
+			case VM::OP_LOAD_GLOBAL:
+				if (d.x < 0 || d.x >= _globals)
+					return false;
+				pushes = 1;
+				break;
+			case VM::OP_STORE_LOCAL:
+				if (d.x < 0 || d.x >= in - 1)
+					return false;
+				pops = 1;
+				break;
+			case VM::OP_STORE_GLOBAL:
+				if (d.x < 0 || d.x >= _globals)
+					return false;
+				pops = 1;
+				break;
+			case VM::OP_JMP:
+				target = d.x;
+				next = false;
+				break;
+			case VM::OP_JE: case VM::OP_JNE: case VM::OP_JL:
+			case VM::OP_JGE: case VM::OP_JG: case VM::OP_JLE:
+				pops = 1;
+				target = d.x;
+				break;
+			case VM::OP_CMP_JE: case VM::OP_CMP_JNE: case VM::OP_CMP_JL:
+			case VM::OP_CMP_JGE: case VM::OP_CMP_JG: case VM::OP_CMP_JLE:
+				pops = 2;
+				target = d.x;
+				break;
+			case VM::OP_CALL:
+				// 调用之后的深度取决于被调用者怎么返回
+				if (!_ok[d.x] || _returns[d.x] < 0)
+					return false;
+				pops = _vm.compiled(d.x).num_par;
+				pushes = _returns[d.x];
+				break;
+			case VM::OP_IRET:
+				pops = 1;
+				next = false;
+				break;
+			case VM::OP_RET:
+			case VM::OP_END:
+				next = false;
+				break;
+			default:
+				// loada、iload、istore：地址要到运行时才知道
+				return false;
+			}
+			if (in < pops)
+				return false;
+			auto out = in - pops + pushes;
+			if (out > max)
+				max = out;
+			if (next && !reach(i + 1, out))
+				return false;
+			if (target >= 0 && !reach(target, out))
+				return false;
+		}
+		_max[fn] = max;
+		return true;
+	}
+
+#ifdef MINIPLC0_VM_JIT
+	void JitCompiler::emitTrampoline() {
+		// int entry(int32_t* stack, int32_t* bp, JitContext* ctx, const void* fn, int64_t frames_left)
+		_as.Bytes({ 0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57 });	// push rbx rbp r12-r15
+		_as.Bytes({ 0x48, 0x83, 0xec, 0x08 });	// sub rsp, 8：进入函数体前 rsp 按 16 对齐
+		_as.RR(0x89, EBX, EDI, true);	// mov rbx, rdi
+		_as.RR(0x89, R13, ESI, true);	// mov r13, rsi
+		_as.RR(0x89, R15, EDX, true);	// mov r15, rdx
+		_as.RR(0x89, R12, R8, true);	// mov r12, r8
+		_as.Mem(0x8b, R14, R15, offsetof(JitContext, limit), true);
+		_as.Mem(0x89, ESP, R15, offsetof(JitContext, saved_rsp), true);
+		_as.Bytes({ 0xff, 0xd1 });	// call rcx
+		auto exit = _as.Pos();
+		_as.Bytes({ 0x48, 0x83, 0xc4, 0x08 });
+		_as.Bytes({ 0x41, 0x5f, 0x41, 0x5e, 0x41, 0x5d, 0x41, 0x5c, 0x5d, 0x5b, 0xc3 });
+		// 陷入：丢掉所有机器码帧，返回 -1
+		_trap_common = _as.Pos();
+		_as.Mem(0x8b, ESP, R15, offsetof(JitContext, saved_rsp), true);
+		_as.MovImm(EAX, -1);
+		_as.Patch(_as.Jump(), exit);
+	}
+
+	void JitCompiler::emitFunction(int32_t fn) {
+		auto& c = _vm.compiled(fn);
+		auto n = c.code.size();
+		std::vector<char> target(n, 0);
+		for (auto& d : c.code)
+			if ((d.op >= VM::OP_JMP && d.op <= VM::OP_JLE) || (d.op >= VM::OP_CMP_JE && d.op <= VM::OP_CMP_JLE))
+				target[d.x] = 1;
+		_entries[fn] = _as.Pos();
+		_labels.assign(n, 0);
+		_jumps.clear();
+		_traps.clear();
+
+		// lea rax, [r13 + 4 * max]; cmp rax, r14; ja 溢出
+		_as.Mem(0x8d, EAX, R13, slot(_max[fn]), true);
+		_as.RR(0x39, EAX, R14, true);
+		trap(_as.Jcc(CC_A), VMStackOverflow, c.origin[0]);
+
+		_cached = false;
+		for (size_t i = 0; i < n; i++) {
+			if (_depth[fn][i] < 0)
+				continue;
+			// 跳转目标处栈顶都在内存里
+			if (target[i])
+				flush();
+			_labels[i] = _as.Pos();
+			_d = _depth[fn][i];
+			emitOp(fn, i);
+		}
+		for (auto& j : _jumps)
+			_as.Patch(j.first, _labels[j.second]);
+		for (auto& t : _traps) {
+			_as.Patch(t.at, _as.Pos());
+			_as.StoreImm(R15, offsetof(JitContext, err), t.err);
+			_as.StoreImm(R15, offsetof(JitContext, function), fn);
+			_as.StoreImm(R15, offsetof(JitContext, pc), t.pc);
+			_as.Patch(_as.Jump(), _trap_common);
+		}
+	}
+
+	void JitCompiler::emitOp(int32_t fn, size_t i) {
+		auto& c = _vm.compiled(fn);
+		auto& d = c.code[i];
+		auto pc = c.origin[i];
+		switch (d.op) {
+		case VM::OP_NOP:
+			break;
+		case VM::OP_PUSH:
+			flush();
+			_as.MovImm(EAX, d.x);
+			push();
+			break;
+		case VM::OP_POP:
+			_d--;
+			_cached = false;
+			break;
+		case VM::OP_LOAD_LOCAL:
+			flush();
+			_as.Load(EAX, R13, slot(d.x));
+			push();
+			break;
+		case VM::OP_LOAD_GLOBAL:
+			flush();
+			_as.Load(EAX, EBX, slot(d.x));
+			push();
+			break;
+		case VM::OP_STORE_LOCAL:
+		case VM::OP_STORE_GLOBAL:
+			top(EAX);
+			_d--;
+			_cached = false;
+			_as.Store(d.op == VM::OP_STORE_LOCAL ? R13 : EBX, slot(d.x), EAX);
+			break;
+		case VM::OP_IADD:
+			pop2();
+			_as.RR(0x01, EAX, ECX);
+			trap(_as.Jcc(CC_O), VMIntegerOverflow, pc);
+			push();
+			break;
+		case VM::OP_ISUB:
+			pop2();
+			_as.RR(0x29, EAX, ECX);
+			trap(_as.Jcc(CC_O), VMIntegerOverflow, pc);
+			push();
+			break;
+		case VM::OP_IMUL:
+			pop2();
+			_as.Bytes({ 0x0f, 0xaf, 0xc1 });	// imul eax, ecx
+			trap(_as.Jcc(CC_O), VMIntegerOverflow, pc);
+			push();
+			break;
+		case VM::OP_IDIV: {
+			pop2();
+			_as.RR(0x85, ECX, ECX);
+			trap(_as.Jcc(CC_E), VMDivideByZero, pc);
+			// INT_MIN / -1 溢出
+			_as.Bytes({ 0x83, 0xf9, 0xff });	// cmp ecx, -1
+			auto skip = _as.Jcc(CC_NE);
+			_as.Byte(0x3d);	// cmp eax, INT_MIN
+			_as.U32(0x80000000u);
+			trap(_as.Jcc(CC_E), VMIntegerOverflow, pc);
+			_as.Patch(skip, _as.Pos());
+			_as.Bytes({ 0x99, 0xf7, 0xf9 });	// cdq; idiv ecx
+			push();
+			break;
+		}
+		case VM::OP_INEG:
+			top(EAX);
+			_d--;
+			_as.Bytes({ 0xf7, 0xd8 });	// neg eax
+			trap(_as.Jcc(CC_O), VMIntegerOverflow, pc);
+			push();
+			break;
+		case VM::OP_ADD_IMM:
+		case VM::OP_SUB_IMM:
+			top(EAX);
+			_d--;
+			_as.Byte(d.op == VM::OP_ADD_IMM ? 0x05 : 0x2d);	// add/sub eax, imm32
+			_as.U32((std::uint32_t)d.x);
+			trap(_as.Jcc(CC_O), VMIntegerOverflow, pc);
+			push();
+			break;
+		case VM::OP_ICMP:
+			pop2();
+			// (a > b) - (a < b)
+			_as.RR(0x39, EAX, ECX);
+			_as.Bytes({ 0x0f, 0x9f, 0xc2, 0x0f, 0x9c, 0xc1 });	// setg dl; setl cl
+			_as.Bytes({ 0x0f, 0xb6, 0xc2, 0x0f, 0xb6, 0xc9 });	// movzx eax, dl; movzx ecx, cl
+			_as.RR(0x29, EAX, ECX);
+			push();
+			break;
+		case VM::OP_JMP:
+			flush();
+			_jumps.emplace_back(_as.Jump(), d.x);
+			break;
+		case VM::OP_JE: case VM::OP_JNE: case VM::OP_JL:
+		case VM::OP_JGE: case VM::OP_JG: case VM::OP_JLE: {
+			static const Cond cc[] = { CC_E, CC_NE, CC_L, CC_GE, CC_G, CC_LE };
+			top(EAX);
+			_d--;
+			_cached = false;
+			_as.RR(0x85, EAX, EAX);
+			_jumps.emplace_back(_as.Jcc(cc[d.op - VM::OP_JE]), d.x);
+			break;
+		}
+		case VM::OP_CMP_JE: case VM::OP_CMP_JNE: case VM::OP_CMP_JL:
+		case VM::OP_CMP_JGE: case VM::OP_CMP_JG: case VM::OP_CMP_JLE: {
+			static const Cond cc[] = { CC_E, CC_NE, CC_L, CC_GE, CC_G, CC_LE };
+			pop2();
+			_as.RR(0x39, EAX, ECX);
+			_jumps.emplace_back(_as.Jcc(cc[d.op - VM::OP_CMP_JE]), d.x);
+			break;
+		}
+		case VM::OP_CALL: {
+			auto np = _vm.compiled(d.x).num_par;
+			flush();
+			// 帧数用完时和解释器一样报在 call 上
+			_as.RR(0x85, R12, R12, true);
+			trap(_as.Jcc(CC_LE), VMStackOverflow, pc);
+			_as.Bytes({ 0x49, 0xff, 0xcc });	// dec r12
+			_as.Bytes({ 0x41, 0x55 });	// push r13
+			_as.Mem(0x8d, R13, R13, slot(_d - np), true);
+			_calls.emplace_back(_as.Call(), d.x);
+			_as.Bytes({ 0x41, 0x5d });	// pop r13
+			_as.Bytes({ 0x49, 0xff, 0xc4 });	// inc r12
+			_d += _returns[d.x] - np;
+			break;
+		}
+		case VM::OP_RET:
+			_as.Bytes({ 0x31, 0xc0, 0xc3 });	// xor eax, eax; ret
+			_cached = false;
+			break;
+		case VM::OP_IRET:
+			top(EAX);
+			_as.Store(R13, 0, EAX);
+			_as.MovImm(EAX, 1);
+			_as.Byte(0xc3);
+			_cached = false;
+			break;
+		case VM::OP_IPRINT:
+		case VM::OP_CPRINT:
+			top(ESI);
+			_d--;
+			_cached = false;
+			_as.RR(0x89, EDI, R15, true);
+			callHelper(d.op == VM::OP_IPRINT ? address(&jitPrintInt) : address(&jitPrintChar));
+			break;
+		case VM::OP_PRINTL:
+			flush();
+			_as.RR(0x89, EDI, R15, true);
+			callHelper(address(&jitPrintLine));
+			break;
+		case VM::OP_ISCAN:
+			flush();
+			_as.RR(0x89, EDI, R15, true);
+			callHelper(address(&jitScan));
+			_as.RR(0x85, EAX, EAX);
+			trap(_as.Jcc(CC_E), VMBadInput, pc);
+			_as.Load(EAX, R15, offsetof(JitContext, value));
+			push();
+			break;
+		case VM::OP_END:
+			// 函数不能越过最后一条指令
+			flush();
+			trap(_as.Jump(), VMBadJump, pc);
+			break;
+		default:
+			// analyse 已经排除了其余的操作码
+			break;
+		}
+	}
+
+	void JitCompiler::flush() {
+		if (_cached)
+			_as.Store(R13, slot(_d - 1), EAX);
+		_cached = false;
+	}
+
+	void JitCompiler::top(int reg) {
+		if (!_cached)
+			_as.Load(reg, R13, slot(_d - 1));
+		else if (reg != EAX)
+			_as.RR(0x89, reg, EAX);
+	}
+
+	void JitCompiler::pop2() {
+		top(ECX);
+		_as.Load(EAX, R13, slot(_d - 2));
+		_d -= 2;
+		_cached = false;
+	}
+
+	void JitCompiler::push() {
+		_d++;
+		_cached = true;
+	}
+
+	void JitCompiler::trap(size_t at, VMErrorCode err, int32_t pc) {
+		_traps.push_back(TrapSite{ at, err, pc });
+	}
+
+	void JitCompiler::callHelper(std::uint64_t address) {
+		// 函数体内 rsp 模 16 余 8，调用 C++ 前补齐
+		_as.Bytes({ 0x48, 0x83, 0xec, 0x08 });
+		_as.CallAbs(address);
+		_as.Bytes({ 0x48, 0x83, 0xc4, 0x08 });
+	}
+#endif
+
+	void VM::jitCompile(int32_t globals) {
+		JitCompiler(*this, globals).Compile();
+	}
+
+	int VM::jitCall(int32_t function, size_t bp, size_t frames_left) {
+		using Entry = int (*)(int32_t*, int32_t*, JitContext*, const void*, int64_t);
+		// 蹦床在代码的开头
+		Entry entry;
+		auto data = _jit_code.Data();
+		std::memcpy(&entry, &data, sizeof(entry));
+		return entry(_stack.data(), _stack.data() + bp, &_jit_context, compiled(function).native, (int64_t)frames_left);
+	}
+}
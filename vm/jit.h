@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace miniplc0 {
+
+	// 机器码和运行时共享的状态，生成的代码按字段偏移直接读写
+	typedef struct {
+		std::ostream* output;
+		std::istream* input;
+		// 操作数栈的末尾，函数入口据此检查栈溢出
+		std::int32_t* limit;
+		// 入口处的 rsp，陷入时直接恢复它，丢掉所有机器码帧
+		void* saved_rsp;
+		// iscan 读到的值
+		std::int32_t value;
+		// 陷入时的错误码、函数和原指令下标
+		std::int32_t err;
+		std::int32_t function;
+		std::int32_t pc;
+	}JitContext;
+
+	// 一块只读可执行的内存，析构时释放
+	class JitBuffer final {
+	public:
+		JitBuffer() : _data(nullptr), _size(0) {}
+		JitBuffer(JitBuffer&&) = delete;
+		JitBuffer(const JitBuffer&) = delete;
+		JitBuffer& operator=(JitBuffer) = delete;
+		~JitBuffer() { release(); }
+
+		// 把 code 复制进新映射的内存再改为可执行，平台不支持或者失败时返回 false
+		bool Load(const std::vector<std::uint8_t>& code);
+		const std::uint8_t* Data() const { return _data; }
+	private:
+		void release();
+	private:
+		std::uint8_t* _data;
+		std::size_t _size;
+	};
+}
@@ -0,0 +1,148 @@
+#include "vm/vm.h"
+#include "instruction/binary.h"
+
+#include <cstring>
+
+namespace miniplc0 {
+
+	namespace {
+
+		std::optional<VMError> readCode(BinaryReader& rdr, std::vector<Instruction>& code, std::int32_t function) {
+			std::uint16_t count;
+			if (!rdr.GetU16(count))
+				return VMError(VMTruncated, function);
+			code.resize(count);
+			// 不认识的操作码和被截断的操作数都算作坏指令
+			for (std::int32_t i = 0; i < count; i++)
+				if (!rdr.GetInstruction(code[i]))
+					return VMError(VMBadOpcode, function, i);
+			return {};
+		}
+
+		// 跳转必须落在本函数内，call 和 loadc 的下标必须存在
+		std::optional<VMError> checkCode(const Module& m, const std::vector<Instruction>& code, std::int32_t function) {
+			for (std::size_t i = 0; i < code.size(); i++) {
+				auto opr = code[i].GetOperation();
+				auto x = code[i].GetX();
+				if (IsJump(opr) && (std::size_t)x >= code.size())
+					return VMError(VMBadJump, function, (std::int32_t)i);
+				if (opr == Operation::call && (std::size_t)x >= m.functions.size())
+					return VMError(VMBadCall, function, (std::int32_t)i);
+				if (opr == Operation::loadc && (std::size_t)x >= m.constants.size())
+					return VMError(VMBadConstant, function, (std::int32_t)i);
+			}
+			return {};
+		}
+	}
+
+	std::pair<Module, std::optional<VMError>> LoadModule(const std::uint8_t* data, std::size_t size, bool verify) {
+		Module m;
+		m.verified = false;
+		m.start_depth = 0;
+		BinaryReader rdr(data, size);
+		auto fail = [&m](VMError err) { return std::make_pair(std::move(m), std::make_optional<VMError>(err)); };
+
+		std::uint32_t magic, version;
+		if (!rdr.GetU32(magic))
+			return fail(VMError(VMTruncated));
+		if (magic != 0x43303a29)
+			return fail(VMError(VMBadMagic));
+		if (!rdr.GetU32(version))
+			return fail(VMError(VMTruncated));
+		if (version != 1 && version != 2)
+			return fail(VMError(VMBadVersion));
+
+		std::uint16_t count;
+		if (!rdr.GetU16(count))
+			return fail(VMError(VMTruncated));
+		m.constants.resize(count);
+		for (auto& c : m.constants) {
+			std::uint8_t type;
+			if (!rdr.GetU8(type))
+				return fail(VMError(VMTruncated));
+			switch (type) {
+			case 0: {
+				std::uint16_t len;
+				std::string_view s;
+				if (!rdr.GetU16(len) || !rdr.GetBytes(len, s))
+					return fail(VMError(VMTruncated));
+				c = VMConstant{ 'S', std::string(s), 0, 0.0 };
+				break;
+			}
+			case 1: {
+				std::uint32_t v;
+				if (!rdr.GetU32(v))
+					return fail(VMError(VMTruncated));
+				c = VMConstant{ 'I', std::string(), (std::int32_t)v, 0.0 };
+				break;
+			}
+			case 2: {
+				std::uint32_t hi, lo;
+				if (!rdr.GetU32(hi) || !rdr.GetU32(lo))
+					return fail(VMError(VMTruncated));
+				std::uint64_t bits = ((std::uint64_t)hi << 32) | lo;
+				double d;
+				std::memcpy(&d, &bits, sizeof(d));
+				c = VMConstant{ 'D', std::string(), 0, d };
+				break;
+			}
+			default:
+				return fail(VMError(VMBadConstant));
+			}
+		}
+
+		auto err = readCode(rdr, m.start, -1);
+		if (err.has_value())
+			return fail(err.value());
+
+		if (!rdr.GetU16(count))
+			return fail(VMError(VMTruncated));
+		m.functions.resize(count);
+		for (std::int32_t i = 0; i < count; i++) {
+			auto& f = m.functions[i];
+			std::uint16_t name_index, num_par, level;
+			if (!rdr.GetU16(name_index) || !rdr.GetU16(num_par) || !rdr.GetU16(level))
+				return fail(VMError(VMTruncated, i));
+			if (name_index >= m.constants.size() || m.constants[name_index].type != 'S')
+				return fail(VMError(VMBadConstant, i));
+			f.name_index = name_index;
+			f.num_par = num_par;
+			f.level = level;
+			f.max_stack = -1;
+			f.num_local = -1;
+			f.max_depth = 0;
+			if (version >= 2) {
+				std::uint16_t max_stack, num_local;
+				if (!rdr.GetU16(max_stack) || !rdr.GetU16(num_local))
+					return fail(VMError(VMTruncated, i));
+				// 0xffff 表示编译器无法静态确定
+				if (max_stack != 0xffff)
+					f.max_stack = max_stack;
+				f.num_local = num_local;
+			}
+			err = readCode(rdr, f.code, i);
+			if (err.has_value())
+				return fail(err.value());
+		}
+
+		err = checkCode(m, m.start, -1);
+		if (err.has_value())
+			return fail(err.value());
+		for (std::int32_t i = 0; i < (std::int32_t)m.functions.size(); i++) {
+			err = checkCode(m, m.functions[i].code, i);
+			if (err.has_value())
+				return fail(err.value());
+		}
+		// 校验不通过不算加载失败，只是执行时走带检查的解释器
+		if (verify)
+			VerifyModule(m);
+		return std::make_pair(std::move(m), std::optional<VMError>());
+	}
+
+	std::int32_t FindFunction(const Module& module, const std::string& name) {
+		for (std::int32_t i = 0; i < (std::int32_t)module.functions.size(); i++)
+			if (module.constants[module.functions[i].name_index].str == name)
+				return i;
+		return -1;
+	}
+}
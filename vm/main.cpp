@@ -0,0 +1,57 @@
+#include "argparse.hpp"
+#include "vm/vm.h"
+#include "tokenizer/source.h"
+
+#include <iostream>
+
+using namespace miniplc0;
+
+int main(int argc, char** argv) {
+	argparse::ArgumentParser program("cc0-vm");
+	program.add_argument("input")
+		.help("the o0 binary produced by cc0 -c");
+	program.add_argument("--jit")
+		.default_value(false)
+		.implicit_value(true)
+		.help("compile functions to x86-64 machine code where possible");
+	program.add_argument("--no-verify")
+		.default_value(false)
+		.implicit_value(true)
+		.help("skip load-time verification and keep every runtime check");
+
+	try {
+		program.parse_args(argc, argv);
+	}
+	catch (const std::runtime_error&) {
+		std::cerr << program;
+		exit(2);
+	}
+
+	auto input_file = program.get<std::string>("input");
+	SourceBuffer image;
+	if (input_file != "-") {
+		if (!image.Open(input_file)) {
+			std::cerr << "Fail to open " << input_file << " for reading.\n";
+			exit(2);
+		}
+	}
+	else
+		image.Read(std::cin);
+
+	auto p = LoadModule(reinterpret_cast<const std::uint8_t*>(image.Data()), image.Size(), !program.get<bool>("--no-verify"));
+	if (p.second.has_value()) {
+		p.second.value().print(std::cerr);
+		exit(2);
+	}
+
+	std::ios::sync_with_stdio(false);
+	VM vm(p.first, std::cin, std::cout);
+	vm.SetJit(program.get<bool>("--jit"));
+	auto err = vm.Run();
+	std::cout.flush();
+	if (err.has_value()) {
+		err.value().print(std::cerr);
+		exit(3);
+	}
+	return 0;
+}
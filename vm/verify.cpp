@@ -0,0 +1,51 @@
+#include "vm/vm.h"
+#include "instruction/stack.h"
+
+namespace miniplc0 {
+
+	std::optional<VMError> VerifyModule(Module& module) {
+		module.verified = false;
+		std::vector<CallTarget> callees;
+		callees.reserve(module.functions.size());
+		for (auto& f : module.functions)
+			callees.push_back(GetCallTarget(f.num_par, f.code));
+
+		// .start 只初始化全局变量：不调用函数（被调用者会看到还没初始化完的全局变量），也不返回
+		StackAnalysis st;
+		auto bad = st.Run(module.start, 0, 0, callees);
+		if (bad.has_value())
+			return VMError(VMUnverified, -1, (std::int32_t)bad.value());
+		auto n = module.start.size();
+		for (std::size_t i = 0; i < n; i++) {
+			auto opr = module.start[i].GetOperation();
+			if (st.Reachable(i) && (opr == Operation::call || opr == Operation::ret || opr == Operation::iret))
+				return VMError(VMUnverified, -1, (std::int32_t)i);
+		}
+		std::int32_t globals = st.Reachable(n) ? st.Depth(n) : 0;
+		module.start_depth = st.MaxDepth();
+
+		for (std::int32_t f = 0; f < (std::int32_t)module.functions.size(); f++) {
+			auto& func = module.functions[f];
+			StackAnalysis fs;
+			bad = fs.Run(func.code, func.num_par, func.level, callees);
+			if (bad.has_value())
+				return VMError(VMUnverified, f, (std::int32_t)bad.value());
+			// 按地址访问的全局变量必须在 .start 结束时已经在栈上
+			auto at = fs.GlobalsWithin(globals);
+			if (at.has_value())
+				return VMError(VMUnverified, f, (std::int32_t)at.value());
+			// 调用者按有没有 iret 决定返回后栈上多一个值，两种返回混用时对不上
+			for (std::size_t i = 0; i < func.code.size(); i++) {
+				auto opr = func.code[i].GetOperation();
+				if (fs.Reachable(i) && callees[f].results > 0 && opr == Operation::ret)
+					return VMError(VMUnverified, f, (std::int32_t)i);
+			}
+			// 函数表里记录的帧不能比实际用到的小
+			if ((func.max_stack >= 0 && func.max_stack < fs.MaxDepth()) || (func.num_local >= 0 && func.num_local < func.num_par))
+				return VMError(VMUnverified, f);
+			func.max_depth = func.max_stack >= 0 ? func.max_stack : fs.MaxDepth();
+		}
+		module.verified = true;
+		return {};
+	}
+}
@@ -0,0 +1,566 @@
+#include "vm/vm.h"
+
+#include <climits>
+
+// computed goto 是 GNU 扩展
+#if defined(MINIPLC0_VM_THREADED) && !defined(__GNUC__)
+#undef MINIPLC0_VM_THREADED
+#endif
+
+#ifdef MINIPLC0_VM_THREADED
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+
+namespace miniplc0 {
+
+	VM::VM(const Module& module, std::istream& input, std::ostream& output, size_t stack_slots, size_t max_frames)
+		: _module(module), _input(input), _output(output), _stack(stack_slots, 0), _sp(0), _frames(),
+		_max_frames(max_frames), _code(module.functions.size() + 1), _linked(false), _jit_enabled(false), _jit_code(),
+		_jit_context{ &output, &input, nullptr, nullptr, 0, 0, 0, 0 } {
+		_frames.reserve(max_frames + 1);
+		std::vector<CallTarget> callees;
+		callees.reserve(module.functions.size());
+		for (auto& f : module.functions)
+			callees.push_back(GetCallTarget(f.num_par, f.code));
+		decode(module.start, 0, callees, _code[0]);
+		for (std::size_t i = 0; i < module.functions.size(); i++) {
+			auto& f = module.functions[i];
+			decode(f.code, f.level, callees, _code[i + 1]);
+			_code[i + 1].num_par = f.num_par;
+			if (module.verified)
+				_code[i + 1].max_depth = f.max_depth;
+		}
+		if (module.verified)
+			_code[0].max_depth = module.start_depth;
+	}
+
+	namespace {
+
+		// 直线代码中指令的 (出栈, 入栈) 槽数；控制流指令返回 false。
+		// call 弹出被调用者的参数、压入它的返回值，碰不到参数下面的槽
+		bool stackEffect(const Instruction& ins, const std::vector<CallTarget>& callees, int& pops, int& pushes) {
+			switch (ins.GetOperation()) {
+			case Operation::nop:
+			case Operation::printl:
+				pops = 0; pushes = 0; return true;
+			case Operation::bipush:
+			case Operation::ipush:
+			case Operation::loadc:
+			case Operation::loada:
+			case Operation::iscan:
+				pops = 0; pushes = 1; return true;
+			case Operation::iload:
+			case Operation::ineg:
+				pops = 1; pushes = 1; return true;
+			case Operation::iadd:
+			case Operation::isub:
+			case Operation::imul:
+			case Operation::idiv:
+			case Operation::icmp:
+				pops = 2; pushes = 1; return true;
+			case Operation::istore:
+				pops = 2; pushes = 0; return true;
+			case Operation::pop:
+			case Operation::iprint:
+			case Operation::cprint:
+				pops = 1; pushes = 0; return true;
+			case Operation::call:
+				// 加载时已经检查过函数下标
+				pops = callees[ins.GetX()].num_par;
+				pushes = callees[ins.GetX()].results;
+				return true;
+			default:
+				return false;
+			}
+		}
+
+		// 从 code[i] 的 loada 往后找消费这个地址的指令：它必须是 istore，且中间的代码
+		// 是不含跳转目标的直线代码、始终没有碰到地址槽。找不到时返回 0
+		std::size_t matchStore(const std::vector<Instruction>& code, std::size_t i, const std::vector<char>& target,
+			const std::vector<CallTarget>& callees) {
+			int depth = 0;
+			for (auto j = i + 1; j < code.size(); j++) {
+				int pops, pushes;
+				if (target[j] || !stackEffect(code[j], callees, pops, pushes))
+					return 0;
+				if (pops > depth)
+					return (code[j].GetOperation() == Operation::istore && depth == 1) ? j : 0;
+				depth += pushes - pops;
+			}
+			return 0;
+		}
+	}
+
+	void VM::decode(const std::vector<Instruction>& code, int32_t level, const std::vector<CallTarget>& callees, Compiled& out) {
+		auto n = code.size();
+		std::vector<Decoded> ops(n);
+		for (std::size_t i = 0; i < n; i++) {
+			auto& ins = code[i];
+			Decoded d{ nullptr, OP_NOP, ins.GetX(), ins.GetY() };
+			switch (ins.GetOperation()) {
+			case Operation::nop: d.op = OP_NOP; break;
+			case Operation::bipush: d.op = OP_PUSH; d.x = ins.GetX() & 0xff; break;
+			case Operation::ipush: d.op = OP_PUSH; break;
+			case Operation::pop: d.op = OP_POP; break;
+			case Operation::loadc: {
+				// 整数常量直接压值，其余压常量下标
+				auto& c = _module.constants[ins.GetX()];
+				d.op = OP_PUSH;
+				d.x = c.type == 'I' ? c.i : ins.GetX();
+				break;
+			}
+			case Operation::loada:
+				// 层次差 0 是当前帧，等于当前层次时是全局（.start 的帧，基址 0）
+				if (ins.GetX() == 0)
+					d.op = OP_LOADA_LOCAL;
+				else if (ins.GetX() == level)
+					d.op = OP_LOADA_GLOBAL;
+				else
+					d.op = OP_BAD_ADDRESS;
+				d.x = ins.GetY();
+				break;
+			case Operation::iload: d.op = OP_ILOAD; break;
+			case Operation::istore: d.op = OP_ISTORE; break;
+			case Operation::iadd: d.op = OP_IADD; break;
+			case Operation::isub: d.op = OP_ISUB; break;
+			case Operation::imul: d.op = OP_IMUL; break;
+			case Operation::idiv: d.op = OP_IDIV; break;
+			case Operation::ineg: d.op = OP_INEG; break;
+			case Operation::icmp: d.op = OP_ICMP; break;
+			case Operation::jmp: d.op = OP_JMP; break;
+			case Operation::je: d.op = OP_JE; break;
+			case Operation::jne: d.op = OP_JNE; break;
+			case Operation::jl: d.op = OP_JL; break;
+			case Operation::jge: d.op = OP_JGE; break;
+			case Operation::jg: d.op = OP_JG; break;
+			case Operation::jle: d.op = OP_JLE; break;
+			case Operation::call: d.op = OP_CALL; break;
+			case Operation::ret: d.op = OP_RET; break;
+			case Operation::iret: d.op = OP_IRET; break;
+			case Operation::iprint: d.op = OP_IPRINT; break;
+			case Operation::cprint: d.op = OP_CPRINT; break;
+			case Operation::printl: d.op = OP_PRINTL; break;
+			case Operation::iscan: d.op = OP_ISCAN; break;
+			default: d.op = OP_END; break; // 加载时已经拒绝了未知操作码
+			}
+			ops[i] = d;
+		}
+
+		std::vector<char> removed(n, 0);
+		fuse(code, callees, ops, removed);
+
+		// 原下标 -> 新下标；被删掉的指令映射到它后面第一条保留的指令
+		std::vector<int32_t> index(n + 1);
+		int32_t k = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			index[i] = k;
+			if (!removed[i])
+				k++;
+		}
+		index[n] = k;
+
+		out.code.clear();
+		out.origin.clear();
+		out.code.reserve(k + 1);
+		out.origin.reserve(k + 1);
+		out.num_par = 0;
+		out.level = level;
+		out.max_depth = 0;
+		for (std::size_t i = 0; i < n; i++) {
+			if (removed[i])
+				continue;
+			auto d = ops[i];
+			if ((d.op >= OP_JMP && d.op <= OP_JLE) || (d.op >= OP_CMP_JE && d.op <= OP_CMP_JLE))
+				d.x = index[d.x];
+			out.code.push_back(d);
+			out.origin.push_back((int32_t)i);
+		}
+		out.code.push_back(Decoded{ nullptr, OP_END, 0, 0 });
+		out.origin.push_back((int32_t)n);
+	}
+
+	void VM::fuse(const std::vector<Instruction>& code, const std::vector<CallTarget>& callees, std::vector<Decoded>& ops,
+		std::vector<char>& removed) {
+		auto n = code.size();
+		// 合并掉的第二条指令不能是跳转目标
+		std::vector<char> target(n + 1, 0);
+		for (auto& ins : code)
+			if (IsJump(ins.GetOperation()))
+				target[ins.GetX()] = 1;
+
+		// loada ... istore：删掉 loada，istore 直接写固定地址。
+		// loada 本身是跳转目标也没关系，跳过来时从它后面的表达式开始执行是等价的
+		for (std::size_t i = 0; i < n; i++) {
+			if (ops[i].op != OP_LOADA_LOCAL && ops[i].op != OP_LOADA_GLOBAL)
+				continue;
+			auto j = matchStore(code, i, target, callees);
+			if (j == 0)
+				continue;
+			removed[i] = 1;
+			ops[j].op = ops[i].op == OP_LOADA_LOCAL ? OP_STORE_LOCAL : OP_STORE_GLOBAL;
+			ops[j].x = ops[i].x;
+		}
+
+		// nop 什么也不做，跳到它的指令改为跳到下一条
+		for (std::size_t i = 0; i < n; i++)
+			if (ops[i].op == OP_NOP)
+				removed[i] = 1;
+
+		for (std::size_t i = 0; i + 1 < n; i++) {
+			if (removed[i] || removed[i + 1] || target[i + 1])
+				continue;
+			auto& d = ops[i];
+			auto next = ops[i + 1].op;
+			if (d.op == OP_LOADA_LOCAL && next == OP_ILOAD)
+				d.op = OP_LOAD_LOCAL;
+			else if (d.op == OP_LOADA_GLOBAL && next == OP_ILOAD)
+				d.op = OP_LOAD_GLOBAL;
+			else if (d.op == OP_ICMP && next >= OP_JE && next <= OP_JLE) {
+				d.op = (Op)(OP_CMP_JE + (next - OP_JE));
+				d.x = ops[i + 1].x;
+			}
+			else if (d.op == OP_PUSH && next == OP_IADD)
+				d.op = OP_ADD_IMM;
+			else if (d.op == OP_PUSH && next == OP_ISUB)
+				d.op = OP_SUB_IMM;
+			else
+				continue;
+			removed[i + 1] = 1;
+		}
+	}
+
+	std::optional<VMError> VM::Run() {
+		_sp = 0;
+		_frames.clear();
+		_frames.push_back(Frame{ -1, _code[0].code.data(), 0 });
+		// 校验过的代码不再逐条检查上溢，进入每个帧之前按最大栈深度检查一次
+		if (_module.verified && _stack.size() < (size_t)_code[0].max_depth)
+			return VMError(VMStackOverflow);
+		auto err = execute(0);
+		if (err.has_value())
+			return err;
+		auto main = FindFunction(_module, "main");
+		if (main < 0)
+			return VMError(VMNoMain);
+		if (_sp < (size_t)compiled(main).num_par)
+			return VMError(VMStackUnderflow, main);
+		if (_jit_enabled)
+			jitCompile((int32_t)_sp);
+		if (compiled(main).native != nullptr) {
+			auto r = jitCall(main, _sp - compiled(main).num_par, _max_frames - 1);
+			if (r < 0)
+				return VMError((VMErrorCode)_jit_context.err, _jit_context.function, _jit_context.pc);
+			return {};
+		}
+		if (_module.verified && _stack.size() - (_sp - compiled(main).num_par) < (size_t)compiled(main).max_depth)
+			return VMError(VMStackOverflow, main);
+		_frames.push_back(Frame{ main, compiled(main).code.data(), _sp - compiled(main).num_par });
+		return execute(0);
+	}
+
+	VMError VM::error(VMErrorCode err, int32_t function, const Decoded* ip) {
+		auto& c = compiled(function);
+		// 出错时 ip 已经越过出错的指令
+		auto i = (ip - 1) - c.code.data();
+		return VMError(err, function, c.origin[i]);
+	}
+
+	template <bool Checked>
+	std::optional<VMError> VM::execute(size_t depth) {
+#ifdef MINIPLC0_VM_THREADED
+		// 与 Op 的顺序一一对应
+		static const void* const labels[OP_COUNT] = {
+			&&L_OP_NOP, &&L_OP_PUSH, &&L_OP_POP, &&L_OP_LOADA_LOCAL, &&L_OP_LOADA_GLOBAL, &&L_OP_BAD_ADDRESS,
+			&&L_OP_ILOAD, &&L_OP_ISTORE, &&L_OP_IADD, &&L_OP_ISUB, &&L_OP_IMUL, &&L_OP_IDIV, &&L_OP_INEG,
+			&&L_OP_ICMP, &&L_OP_JMP, &&L_OP_JE, &&L_OP_JNE, &&L_OP_JL, &&L_OP_JGE, &&L_OP_JG, &&L_OP_JLE,
+			&&L_OP_CALL, &&L_OP_RET, &&L_OP_IRET, &&L_OP_IPRINT, &&L_OP_CPRINT, &&L_OP_PRINTL, &&L_OP_ISCAN,
+			&&L_OP_LOAD_LOCAL, &&L_OP_LOAD_GLOBAL, &&L_OP_STORE_LOCAL, &&L_OP_STORE_GLOBAL,
+			&&L_OP_CMP_JE, &&L_OP_CMP_JNE, &&L_OP_CMP_JL, &&L_OP_CMP_JGE, &&L_OP_CMP_JG, &&L_OP_CMP_JLE,
+			&&L_OP_ADD_IMM, &&L_OP_SUB_IMM,
+			&&L_OP_END,
+		};
+		if (!_linked) {
+			for (auto& c : _code)
+				for (auto& d : c.code)
+					d.handler = labels[d.op];
+			_linked = true;
+		}
+#define CASE(op) L_##op:
+#define DISPATCH() goto *(ip++)->handler
+#else
+#define CASE(op) case op:
+#define DISPATCH() goto dispatch
+#endif
+
+#define TRAP(err) return error(err, fn, ip)
+#define POP(v) \
+		do { \
+			if (Checked && sp <= bp) \
+				TRAP(VMStackUnderflow); \
+			v = stack[--sp]; \
+		} while (0)
+#define PUSH(v) \
+		do { \
+			if (Checked && sp >= capacity) \
+				TRAP(VMStackOverflow); \
+			stack[sp++] = (v); \
+		} while (0)
+#define CMP_JUMP(cond) \
+		do { \
+			int32_t l_, r_; \
+			POP(r_); \
+			POP(l_); \
+			if (l_ cond r_) \
+				ip = code + ip[-1].x; \
+			DISPATCH(); \
+		} while (0)
+#define JUMP(cond) \
+		do { \
+			int32_t v_; \
+			POP(v_); \
+			if (v_ cond 0) \
+				ip = code + ip[-1].x; \
+			DISPATCH(); \
+		} while (0)
+
+		// 热循环中的状态都放在局部变量里，只在调用和返回时与 _frames 同步
+		int32_t* stack = _stack.data();
+		const size_t capacity = _stack.size();
+		size_t sp = _sp;
+		int32_t fn = _frames.back().function;
+		const Decoded* code = compiled(fn).code.data();
+		const Decoded* ip = _frames.back().ip;
+		size_t bp = _frames.back().bp;
+		int32_t a, b;
+
+#ifdef MINIPLC0_VM_THREADED
+		DISPATCH();
+#else
+	dispatch:
+		switch ((ip++)->op) {
+#endif
+		CASE(OP_NOP)
+			DISPATCH();
+		CASE(OP_PUSH)
+			PUSH(ip[-1].x);
+			DISPATCH();
+		CASE(OP_POP)
+			POP(a);
+			DISPATCH();
+		CASE(OP_LOADA_LOCAL)
+			PUSH((int32_t)(bp + ip[-1].x));
+			DISPATCH();
+		CASE(OP_LOADA_GLOBAL)
+			PUSH(ip[-1].x);
+			DISPATCH();
+		CASE(OP_BAD_ADDRESS)
+			TRAP(VMBadAddress);
+		CASE(OP_ILOAD)
+			POP(a);
+			if (Checked && (a < 0 || (size_t)a >= sp))
+				TRAP(VMBadAddress);
+			PUSH(stack[a]);
+			DISPATCH();
+		CASE(OP_ISTORE)
+			POP(b);
+			POP(a);
+			if (Checked && (a < 0 || (size_t)a >= sp))
+				TRAP(VMBadAddress);
+			stack[a] = b;
+			DISPATCH();
+		CASE(OP_IADD)
+			POP(b);
+			POP(a);
+			if ((b > 0 && a > INT_MAX - b) || (b < 0 && a < INT_MIN - b))
+				TRAP(VMIntegerOverflow);
+			PUSH(a + b);
+			DISPATCH();
+		CASE(OP_ISUB)
+			POP(b);
+			POP(a);
+			if ((b < 0 && a > INT_MAX + b) || (b > 0 && a < INT_MIN + b))
+				TRAP(VMIntegerOverflow);
+			PUSH(a - b);
+			DISPATCH();
+		CASE(OP_IMUL) {
+			POP(b);
+			POP(a);
+			int64_t r = (int64_t)a * (int64_t)b;
+			if (r < INT_MIN || r > INT_MAX)
+				TRAP(VMIntegerOverflow);
+			PUSH((int32_t)r);
+			DISPATCH();
+		}
+		CASE(OP_IDIV)
+			POP(b);
+			POP(a);
+			if (b == 0)
+				TRAP(VMDivideByZero);
+			if (a == INT_MIN && b == -1)
+				TRAP(VMIntegerOverflow);
+			PUSH(a / b);
+			DISPATCH();
+		CASE(OP_INEG)
+			POP(a);
+			if (a == INT_MIN)
+				TRAP(VMIntegerOverflow);
+			PUSH(-a);
+			DISPATCH();
+		CASE(OP_ICMP)
+			POP(b);
+			POP(a);
+			PUSH(a > b ? 1 : (a < b ? -1 : 0));
+			DISPATCH();
+		CASE(OP_JMP)
+			ip = code + ip[-1].x;
+			DISPATCH();
+		CASE(OP_JE)
+			JUMP(==);
+		CASE(OP_JNE)
+			JUMP(!=);
+		CASE(OP_JL)
+			JUMP(<);
+		CASE(OP_JGE)
+			JUMP(>=);
+		CASE(OP_JG)
+			JUMP(>);
+		CASE(OP_JLE)
+			JUMP(<=);
+		CASE(OP_CALL) {
+			auto callee = ip[-1].x;
+			auto& c = compiled(callee);
+			if (_frames.size() >= _max_frames)
+				TRAP(VMStackOverflow);
+			// 参数已经由调用者压栈，它们就是新帧的前 num_par 个槽
+			if (Checked && sp - bp < (size_t)c.num_par)
+				TRAP(VMStackUnderflow);
+			if (!Checked && capacity - (sp - c.num_par) < (size_t)c.max_depth)
+				TRAP(VMStackOverflow);
+			if (c.native != nullptr) {
+				// 机器码函数一直执行到返回，返回值已经留在新帧的第一个槽
+				auto r = jitCall(callee, sp - c.num_par, _max_frames - _frames.size() - 1);
+				if (r < 0)
+					return VMError((VMErrorCode)_jit_context.err, _jit_context.function, _jit_context.pc);
+				sp = sp - c.num_par + r;
+				DISPATCH();
+			}
+			_frames.back().ip = ip;
+			bp = sp - c.num_par;
+			_frames.push_back(Frame{ callee, nullptr, bp });
+			fn = callee;
+			code = c.code.data();
+			ip = code;
+			DISPATCH();
+		}
+		CASE(OP_RET)
+			sp = bp;
+			goto leave;
+		CASE(OP_IRET)
+			POP(a);
+			sp = bp;
+			// 返回值至少占过一个槽，这里不会溢出
+			stack[sp++] = a;
+			goto leave;
+		CASE(OP_IPRINT)
+			POP(a);
+			_output << a;
+			DISPATCH();
+		CASE(OP_CPRINT)
+			POP(a);
+			_output << (char)a;
+			DISPATCH();
+		CASE(OP_PRINTL)
+			_output << '\n';
+			DISPATCH();
+		CASE(OP_ISCAN)
+			if (!(_input >> a))
+				TRAP(VMBadInput);
+			PUSH(a);
+			DISPATCH();
+		CASE(OP_LOAD_LOCAL)
+			a = (int32_t)(bp + ip[-1].x);
+			if (Checked && (a < 0 || (size_t)a >= sp))
+				TRAP(VMBadAddress);
+			PUSH(stack[a]);
+			DISPATCH();
+		CASE(OP_LOAD_GLOBAL)
+			a = ip[-1].x;
+			if (Checked && (a < 0 || (size_t)a >= sp))
+				TRAP(VMBadAddress);
+			PUSH(stack[a]);
+			DISPATCH();
+		CASE(OP_STORE_LOCAL)
+			POP(b);
+			a = (int32_t)(bp + ip[-1].x);
+			if (Checked && (a < 0 || (size_t)a >= sp))
+				TRAP(VMBadAddress);
+			stack[a] = b;
+			DISPATCH();
+		CASE(OP_STORE_GLOBAL)
+			POP(b);
+			a = ip[-1].x;
+			if (Checked && (a < 0 || (size_t)a >= sp))
+				TRAP(VMBadAddress);
+			stack[a] = b;
+			DISPATCH();
+		CASE(OP_CMP_JE)
+			CMP_JUMP(==);
+		CASE(OP_CMP_JNE)
+			CMP_JUMP(!=);
+		CASE(OP_CMP_JL)
+			CMP_JUMP(<);
+		CASE(OP_CMP_JGE)
+			CMP_JUMP(>=);
+		CASE(OP_CMP_JG)
+			CMP_JUMP(>);
+		CASE(OP_CMP_JLE)
+			CMP_JUMP(<=);
+		CASE(OP_ADD_IMM)
+			POP(a);
+			b = ip[-1].x;
+			if ((b > 0 && a > INT_MAX - b) || (b < 0 && a < INT_MIN - b))
+				TRAP(VMIntegerOverflow);
+			PUSH(a + b);
+			DISPATCH();
+		CASE(OP_SUB_IMM)
+			POP(a);
+			b = ip[-1].x;
+			if ((b < 0 && a > INT_MAX + b) || (b > 0 && a < INT_MIN + b))
+				TRAP(VMIntegerOverflow);
+			PUSH(a - b);
+			DISPATCH();
+		CASE(OP_END)
+			// .start 执行完毕；函数不能越过最后一条指令
+			if (fn >= 0)
+				TRAP(VMBadJump);
+			goto leave;
+#ifndef MINIPLC0_VM_THREADED
+		default:
+			TRAP(VMBadOpcode);
+		}
+#endif
+
+	leave:
+		_frames.pop_back();
+		if (_frames.size() <= depth) {
+			_sp = sp;
+			return {};
+		}
+		fn = _frames.back().function;
+		code = compiled(fn).code.data();
+		ip = _frames.back().ip;
+		bp = _frames.back().bp;
+		DISPATCH();
+
+#undef CASE
+#undef DISPATCH
+#undef TRAP
+#undef POP
+#undef PUSH
+#undef JUMP
+#undef CMP_JUMP
+	}
+
+	template std::optional<VMError> VM::execute<true>(size_t depth);
+	template std::optional<VMError> VM::execute<false>(size_t depth);
+}
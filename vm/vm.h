@@ -0,0 +1,262 @@
+#pragma once
+
+#include "instruction/instruction.h"
+#include "instruction/stack.h"
+#include "vm/jit.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace miniplc0 {
+
+	enum VMErrorCode {
+		VMNoError,
+		VMBadMagic,
+		VMBadVersion,
+		VMTruncated,
+		VMBadOpcode,
+		VMBadConstant,
+		VMBadJump,
+		VMBadCall,
+		VMNoMain,
+		VMStackOverflow,
+		VMStackUnderflow,
+		VMBadAddress,
+		VMDivideByZero,
+		VMIntegerOverflow,
+		VMBadInput,
+		VMUnverified
+	};
+
+	// 加载或运行时的错误。function 为 -1 表示 .start 或者文件本身，pc 为出错指令的下标
+	class VMError final {
+	private:
+		using int32_t = std::int32_t;
+	public:
+		VMError(VMErrorCode err, int32_t function = -1, int32_t pc = 0) : _err(err), _function(function), _pc(pc) {}
+
+		VMErrorCode GetCode() const { return _err; }
+		int32_t GetFunction() const { return _function; }
+		int32_t GetPc() const { return _pc; }
+
+		static const char* CtS(VMErrorCode ec) {
+			switch (ec) {
+			case VMNoError: return "VMNoError";
+			case VMBadMagic: return "VMBadMagic";
+			case VMBadVersion: return "VMBadVersion";
+			case VMTruncated: return "VMTruncated";
+			case VMBadOpcode: return "VMBadOpcode";
+			case VMBadConstant: return "VMBadConstant";
+			case VMBadJump: return "VMBadJump";
+			case VMBadCall: return "VMBadCall";
+			case VMNoMain: return "VMNoMain";
+			case VMStackOverflow: return "VMStackOverflow";
+			case VMStackUnderflow: return "VMStackUnderflow";
+			case VMBadAddress: return "VMBadAddress";
+			case VMDivideByZero: return "VMDivideByZero";
+			case VMIntegerOverflow: return "VMIntegerOverflow";
+			case VMBadInput: return "VMBadInput";
+			case VMUnverified: return "VMUnverified";
+			}
+			return "VMUnknownError";
+		}
+
+		void print(std::ostream& os) const {
+			if (_function < 0)
+				os << "Err at .start:" << _pc << ":\t" << CtS(_err) << "\n";
+			else
+				os << "Err at .F" << _function << ":" << _pc << ":\t" << CtS(_err) << "\n";
+		}
+	private:
+		VMErrorCode _err;
+		int32_t _function;
+		int32_t _pc;
+	};
+
+	// 常量池中的一项：'S' 字符串，'I' 整数，'D' 浮点
+	typedef struct {
+		char type;
+		std::string str;
+		std::int32_t i;
+		double d;
+	}VMConstant;
+
+	typedef struct {
+		std::int32_t name_index;
+		std::int32_t num_par;
+		std::int32_t level;
+		std::vector<Instruction> code;
+		// version 2 的函数表里记录的最大栈深度和局部槽数，version 1 或者编译器无法确定时为 -1
+		std::int32_t max_stack;
+		std::int32_t num_local;
+		// 校验通过时为包括参数在内的最大栈深度
+		std::int32_t max_depth;
+	}VMFunction;
+
+	// 一个加载好的 o0 文件
+	typedef struct {
+		std::vector<VMConstant> constants;
+		std::vector<Instruction> start;
+		std::vector<VMFunction> functions;
+		// 通过了 VerifyModule，可以用不做逐条检查的解释器执行
+		bool verified;
+		std::int32_t start_depth;
+	}Module;
+
+	// 解析 printBinary 输出的 o0 文件（magic "C0:)"，version 1 或 2），同时检查跳转和调用目标。
+	// verify 为真时最后做一遍 VerifyModule，否则 verified 保持为假
+	std::pair<Module, std::optional<VMError>> LoadModule(const std::uint8_t* data, std::size_t size, bool verify = true);
+	// 对每个指令流做静态栈分析，证明每条指令处的栈深度唯一且不下溢、地址只指向已有的槽、
+	// loada 的层次合法、call 的参数个数够、返回值个数和调用者的预期一致。
+	// 函数表里记录了栈深度时还要求它不小于分析出的深度，此时按记录的深度分配帧。
+	// 通过时设置 verified 和各个最大栈深度；不通过时返回第一处问题，模块仍然可以用带检查的解释器执行
+	std::optional<VMError> VerifyModule(Module& module);
+	// 找到名为 main 的函数，没有时返回 -1
+	std::int32_t FindFunction(const Module& module, const std::string& name);
+
+	class JitCompiler;
+
+	// o0 解释器：操作数栈和调用帧都在构造时一次分配好，运行中不再申请内存。
+	// 栈槽为 32 位，地址就是槽的下标。
+	// 构造时把每个函数预解码成内部指令流（loadc、loada 的层次在这一步解析掉），
+	// 编译器支持时用 computed goto 直接跳到处理代码，否则退回 switch，见 MINIPLC0_VM_THREADED。
+	// 模块通过校验时改用去掉栈上下溢和地址检查的解释器，只在 call 处按被调用者的最大栈深度检查一次。
+	// 打开 JIT 后能翻译成 x86-64 机器码的函数直接执行机器码，见 vm/jit.cpp。
+	class VM final {
+		friend class JitCompiler;
+	private:
+		using int32_t = std::int32_t;
+		using int64_t = std::int64_t;
+		using size_t = std::size_t;
+
+		// 预解码后的内部操作码
+		enum Op : std::uint8_t {
+			OP_NOP,
+			OP_PUSH,
+			OP_POP,
+			OP_LOADA_LOCAL,
+			OP_LOADA_GLOBAL,
+			OP_BAD_ADDRESS,
+			OP_ILOAD,
+			OP_ISTORE,
+			OP_IADD,
+			OP_ISUB,
+			OP_IMUL,
+			OP_IDIV,
+			OP_INEG,
+			OP_ICMP,
+			OP_JMP,
+			OP_JE,
+			OP_JNE,
+			OP_JL,
+			OP_JGE,
+			OP_JG,
+			OP_JLE,
+			OP_CALL,
+			OP_RET,
+			OP_IRET,
+			OP_IPRINT,
+			OP_CPRINT,
+			OP_PRINTL,
+			OP_ISCAN,
+			// 以下是预解码时合并出来的超级指令
+			// loada + iload
+			OP_LOAD_LOCAL,
+			OP_LOAD_GLOBAL,
+			// loada ... istore，地址不再入栈
+			OP_STORE_LOCAL,
+			OP_STORE_GLOBAL,
+			// icmp + jcc
+			OP_CMP_JE,
+			OP_CMP_JNE,
+			OP_CMP_JL,
+			OP_CMP_JGE,
+			OP_CMP_JG,
+			OP_CMP_JLE,
+			// ipush + iadd / isub
+			OP_ADD_IMM,
+			OP_SUB_IMM,
+			// 每个指令流末尾的哨兵：.start 到此结束，函数走到这里是错误
+			OP_END,
+			OP_COUNT
+		};
+
+		typedef struct {
+			// 线程化分派时为处理代码的地址
+			const void* handler;
+			Op op;
+			int32_t x;
+			int32_t y;
+		}Decoded;
+
+		typedef struct {
+			std::vector<Decoded> code;
+			// 预解码指令 -> 原指令下标，用于报错
+			std::vector<int32_t> origin;
+			int32_t num_par;
+			int32_t level;
+			// 校验通过时的最大栈深度
+			int32_t max_depth;
+			// JIT 生成的入口，nullptr 表示解释执行
+			const void* native;
+		}Compiled;
+
+		typedef struct {
+			// -1 为 .start
+			int32_t function;
+			const Decoded* ip;
+			// 帧基址：参数和局部变量从这里开始
+			size_t bp;
+		}Frame;
+	public:
+		VM(const Module& module, std::istream& input, std::ostream& output,
+			size_t stack_slots = 1 << 20, size_t max_frames = 1 << 16);
+		VM(const VM&) = delete;
+		VM(VM&&) = delete;
+		VM& operator=(VM) = delete;
+
+		// 先执行 .start 初始化全局变量，再调用 main
+		std::optional<VMError> Run();
+		// 在 Run 之前调用。不支持的平台上没有效果
+		void SetJit(bool enable) { _jit_enabled = enable; }
+		// Run 之后查询函数是否由 JIT 生成的机器码执行
+		bool IsNative(int32_t function) const { return _code[function + 1].native != nullptr; }
+	private:
+		// callees 为各个函数的参数和返回值个数，合并 loada ... istore 时用来越过其间的 call
+		void decode(const std::vector<Instruction>& code, int32_t level, const std::vector<CallTarget>& callees, Compiled& out);
+		// 把 loada/icmp/ipush 开头的常见序列合并成一条，removed 标记被吃掉的指令
+		void fuse(const std::vector<Instruction>& code, const std::vector<CallTarget>& callees, std::vector<Decoded>& ops,
+			std::vector<char>& removed);
+		// 从 _frames.back() 开始执行，直到调用栈深度回到 depth。
+		// Checked 为 false 时不做校验已经证明过的检查。一个 VM 只用其中一个版本，两者共用 handler
+		template <bool Checked>
+		std::optional<VMError> execute(size_t depth);
+		std::optional<VMError> execute(size_t depth) { return _module.verified ? execute<false>(depth) : execute<true>(depth); }
+		Compiled& compiled(int32_t function) { return _code[function + 1]; }
+		VMError error(VMErrorCode err, int32_t function, const Decoded* ip);
+		// 以当前栈上的全局变量数编译所有能编译的函数，见 vm/jit.cpp
+		void jitCompile(int32_t globals);
+		// 执行机器码函数，参数已经在 bp 开始的槽里。返回 0 为 ret，1 为 iret，-1 为运行时错误
+		int jitCall(int32_t function, size_t bp, size_t frames_left);
+	private:
+		const Module& _module;
+		std::istream& _input;
+		std::ostream& _output;
+		std::vector<int32_t> _stack;
+		size_t _sp;
+		std::vector<Frame> _frames;
+		size_t _max_frames;
+		// [0] 为 .start，[i + 1] 为第 i 个函数
+		std::vector<Compiled> _code;
+		// handler 是否已经填好
+		bool _linked;
+		bool _jit_enabled;
+		JitBuffer _jit_code;
+		JitContext _jit_context;
+	};
+}